@@ -177,7 +177,7 @@ PRIM(access) {
 }
 
 extern Dict *initprims_access(Dict *primdict) {
-	X(access);
+	XPURE(access);
 	return primdict;
 }
 
@@ -10,12 +10,16 @@
 DefineTag(Closure, static);
 
 extern Closure *mkclosure(Tree *tree, Binding *binding)
-{   gcdisable();
-    Ref(Closure *, closure, gcnew(Closure));
+{   Closure *closure;
+    if (GCNEEDRESERVE(GCSIZE(Closure)))
+    {   RefAdd2(tree, binding);
+        gcreserve(GCSIZE(Closure));
+        RefRemove2(binding, tree);
+    }
+    closure          = gcnewreserved(Closure);
     closure->tree    = tree;
     closure->binding = binding;
-    gcenable();
-    RefReturn(closure);
+    return closure;
 }
 
 static void *ClosureCopy(void *original_ptr)
@@ -44,6 +48,7 @@ static Tree *revtree(Tree *tree)
     {   assert(tree->kind == nList);
         next_node     = tree->u[1].p;
         tree->u[1].p  = previous_node;
+        gcremember(tree);
         previous_node = tree;
 	 
     }
@@ -176,15 +181,19 @@ extern Closure *extractbindings(Tree *input_tree)
 DefineTag(Binding, static);
 
 extern Binding *mkbinding(char *name, List *definition, Binding *next)
-{   assert(next == NULL || next->name != NULL);
+{   Binding *binding;
+    assert(next == NULL || next->name != NULL);
     validatevar(name);
-    gcdisable();
-    Ref(Binding *, binding, gcnew(Binding));
+    if (GCNEEDRESERVE(GCSIZE(Binding)))
+    {   RefAdd3(name, definition, next);
+        gcreserve(GCSIZE(Binding));
+        RefRemove3(next, definition, name);
+    }
+    binding       = gcnewreserved(Binding);
     binding->name = name;
     binding->defn = definition;
     binding->next = next;
-    gcenable();
-    RefReturn(binding);
+    return binding;
 }
 
 extern Binding *reversebindings(Binding *binding)
@@ -200,6 +209,7 @@ extern Binding *reversebindings(Binding *binding)
         do
         {   next_binding     = binding->next;
             binding->next    = previous_binding;
+            gcremember(binding);
             previous_binding = binding;
         }
 		while ((binding = next_binding) != NULL);
@@ -211,7 +221,8 @@ extern Binding *reversebindings(Binding *binding)
 static void *BindingCopy(void *original_ptr)
 {   void *new_ptr = gcnew(Binding);
     memcpy(new_ptr, original_ptr, sizeof(Binding));
- 
+    forwardahead(((Binding *) new_ptr)->name);
+    forwardahead(((Binding *) new_ptr)->defn);
     return new_ptr;
 }
 
@@ -0,0 +1,747 @@
+/* code.c -- compiling sealed parse trees for a simple stack machine */
+
+#include "es.h"
+#include "gc.h"
+
+/*
+ * sealed trees never change, so most of what walk() and glom() do
+ * each time they visit one -- dispatching on node kinds, recursing
+ * for each subtree, building quote lists for words which could never
+ * be globbed -- can be worked out once.  getcode() compiles a tree
+ * into a flat sequence of instructions for runcode() and caches it
+ * by the tree's address.  code refers only to its tree and to the
+ * trees and strings inside it, which sweepcode() follows when the
+ * code space is compacted.  local and for, and any tree which is not
+ * sealed, are left to the tree walker.
+ *
+ * only sealed trees are compiled.  every tree the parser makes is
+ * sealed by pseal(), whether it came from a script, from interactive
+ * input, or from parsestring() turning a function's text back into
+ * a closure, so functions defined at the prompt are compiled like
+ * any other.  a tree built in the collected heap is always walked.
+ * dispatch in runcode() is a plain switch, and the bodies of local
+ * and for are walked even inside compiled code.
+ */
+
+#define	MAXSLOTS	32		/* deepest expression stack code may use */
+#define	MAXBINDINGS	16		/* deepest binding stack code may use */
+
+typedef enum {
+	opNil,		/* push () */
+	opWord,		/* s: push a word */
+	opRawWord,	/* s: push a word which may be globbed */
+	opClosure,	/* t: push a thunk or lambda closed over the binding */
+	opPrim,		/* t: push a primitive */
+	opVar,		/* replace a list of names with their values */
+	opVarsubName,	/* replace a name with its value, ready for opVarsub */
+	opVarsub,	/* subscript the value below with the list on top */
+	opConcat,	/* replace the top two lists with their cross product */
+	opQconcat,	/* opConcat, with quote lists */
+	opAppend,	/* append the top list to the one below it */
+	opQappend,	/* opAppend, with quote lists */
+	opQuote,	/* give the top list a quote list marking it quoted */
+	opGlob,		/* glob the top list */
+	opResult,	/* push a copy of the result */
+	opCheckNames,	/* fail unless the top list has a variable name */
+	opAssign,	/* assign the values on top to the names below them */
+	opLetBegin,	/* start a new binding for let */
+	opLetBind,	/* add the values on top to the new binding as the names below them */
+	opLetEnd,	/* make the new binding current */
+	opSave,		/* save the current binding */
+	opRestore,	/* restore the saved binding */
+	opEval,		/* i: evaluate the top list, passing on the flags if i */
+	opWalk,		/* t i: walk a tree the compiler left alone */
+	opMatch,	/* match the list below against the pattern on top */
+	opExtract,	/* opMatch, but extract the matched text */
+	opTrue,		/* the result is true */
+	opEnd
+} Op;
+
+/* the operands which follow each instruction: s for strings, t for trees, i for ints */
+static const char *const operands[] = {
+	"", "s", "s", "t", "t", "", "", "", "", "", "", "", "", "",
+	"", "", "", "", "", "", "", "", "i", "ti", "", "", "", ""
+};
+
+typedef union {
+	Op op;
+	char *s;
+	Tree *t;
+	int i;
+} Inst;
+
+struct Code {
+	Tree *tree;
+	CodeRole role;
+	int slots;		/* expression stack depth */
+	int bindings;		/* binding stack depth */
+	Boolean quoting;	/* are quote lists kept on the expression stack? */
+	Code *next;		/* in the hash chain */
+	int len;		/* 0 if the tree was not compiled */
+	Boolean throws;		/* codeReturns: could walking the tree throw a return? */
+	Inst inst[1];
+};
+
+typedef struct {
+	List *head, *tail;
+	StrList *qhead, *qtail;
+} Slot;
+
+
+/*
+ * the compiler
+ */
+
+static Inst *buf = NULL;
+static int buflen, bufmax = 0;
+static int depth, maxdepth, bdepth, maxbdepth;
+static Boolean quoting, failed;
+
+static void compilestmt(Tree *tree, Boolean tail);
+
+/* emit -- add an instruction or operand to the code being built */
+static Inst *emit(void) {
+	if (buflen >= bufmax) {
+		bufmax = bufmax == 0 ? 64 : bufmax * 2;
+		buf = erealloc(buf, bufmax * sizeof (Inst));
+	}
+	return &buf[buflen++];
+}
+
+#define	emitop(o)	(emit()->op = (o))
+#define	emits(str)	(emit()->s = (str))
+#define	emitt(tree)	(emit()->t = (tree))
+#define	emiti(n)	(emit()->i = (n))
+
+/* push, pop -- track the depth of the expression stack */
+static void push(void) {
+	if (++depth > maxdepth)
+		maxdepth = depth;
+}
+
+#define	pop(n)	(depth -= (n))
+
+/* bpush, bpop -- track the depth of the binding stack */
+static void bpush(void) {
+	if (++bdepth > maxbdepth)
+		maxbdepth = bdepth;
+}
+
+#define	bpop()	(--bdepth)
+
+/* needsglob -- could glom2() produce an unquoted wildcard or tilde for this tree? */
+static Boolean needsglob(Tree *tree) {
+	if (tree == NULL)
+		return FALSE;
+	switch (tree->kind) {
+	case nWord:
+		return strpbrk(tree->u[0].s, "*?[~") != NULL;
+	case nList: case nConcat:
+		return needsglob(tree->u[0].p) || needsglob(tree->u[1].p);
+	default:
+		return FALSE;
+	}
+}
+
+/* compilelist -- push the value of a tree, as glom1() or, with quote lists, glom2() would */
+static void compilelist(Tree *tree, Boolean q) {
+	if (q && (tree == NULL || (tree->kind != nWord && tree->kind != nList && tree->kind != nConcat))) {
+		compilelist(tree, FALSE);
+		emitop(opQuote);
+		quoting = TRUE;
+		return;
+	}
+	if (tree == NULL) {
+		emitop(opNil);
+		push();
+		return;
+	}
+	switch (tree->kind) {
+	case nWord:
+		if (q) {
+			emitop(opRawWord);
+			quoting = TRUE;
+		} else
+			emitop(opWord);
+		emits(tree->u[0].s);
+		push();
+		break;
+	case nQword:
+		emitop(opWord);
+		emits(tree->u[0].s);
+		push();
+		break;
+	case nThunk: case nLambda:
+		emitop(opClosure);
+		emitt(tree);
+		push();
+		break;
+	case nPrim:
+		emitop(opPrim);
+		emitt(tree);
+		push();
+		break;
+	case nVar:
+		compilelist(tree->u[0].p, FALSE);
+		emitop(opVar);
+		break;
+	case nVarsub:
+		compilelist(tree->u[0].p, FALSE);
+		emitop(opVarsubName);
+		compilelist(tree->u[1].p, FALSE);
+		emitop(opVarsub);
+		pop(1);
+		break;
+	case nCall:
+		if (tree->u[0].p != NULL
+		    && (tree->u[0].p->kind == nLet || tree->u[0].p->kind == nClosure)) {
+			emitop(opSave);
+			bpush();
+			compilestmt(tree->u[0].p, FALSE);
+			emitop(opRestore);
+			bpop();
+		} else
+			compilestmt(tree->u[0].p, FALSE);
+		emitop(opResult);
+		push();
+		break;
+	case nList:
+		compilelist(tree->u[0].p, q);
+		for (tree = tree->u[1].p; tree != NULL;) {
+			Tree *item = tree;
+			if (tree->kind == nList) {
+				item = tree->u[0].p;
+				tree = tree->u[1].p;
+			} else
+				tree = NULL;
+			compilelist(item, q);
+			emitop(q ? opQappend : opAppend);
+			pop(1);
+		}
+		break;
+	case nConcat:
+		compilelist(tree->u[0].p, q);
+		compilelist(tree->u[1].p, q);
+		emitop(q ? opQconcat : opConcat);
+		pop(1);
+		break;
+	default:
+		failed = TRUE;
+		emitop(opNil);
+		push();
+		break;
+	}
+}
+
+/* compileglob -- push the value of a tree, globbed as glom() would */
+static void compileglob(Tree *tree) {
+	if (needsglob(tree)) {
+		compilelist(tree, TRUE);
+		emitop(opGlob);
+	} else
+		compilelist(tree, FALSE);
+}
+
+/* compilepattern -- push the value of a tree with a quote list, as glom2() would */
+static void compilepattern(Tree *tree) {
+	if (needsglob(tree))
+		compilelist(tree, TRUE);
+	else {
+		/* with no wildcards, it makes no difference what is quoted */
+		compilelist(tree, FALSE);
+		emitop(opQuote);
+		quoting = TRUE;
+	}
+}
+
+/* compilestmt -- evaluate a tree for its result, as walk() would */
+static void compilestmt(Tree *tree, Boolean tail) {
+	Tree *defn;
+
+	if (tree == NULL) {
+		emitop(opTrue);
+		return;
+	}
+	switch (tree->kind) {
+	case nConcat: case nList: case nQword: case nVar: case nVarsub:
+	case nWord: case nThunk: case nLambda: case nCall: case nPrim:
+		compileglob(tree);
+		emitop(opEval);
+		emiti(tail);
+		pop(1);
+		break;
+	case nAssign:
+		compilelist(tree->u[0].p, FALSE);
+		emitop(opCheckNames);
+		compileglob(tree->u[1].p);
+		emitop(opAssign);
+		pop(2);
+		break;
+	case nLet: case nClosure:
+		emitop(opLetBegin);
+		bpush();
+		for (defn = tree->u[0].p; defn != NULL; defn = defn->u[1].p) {
+			Tree *assign;
+			if (defn->kind != nList) {
+				failed = TRUE;
+				break;
+			}
+			if ((assign = defn->u[0].p) == NULL)
+				continue;
+			if (assign->kind != nAssign) {
+				failed = TRUE;
+				break;
+			}
+			compilelist(assign->u[0].p, FALSE);
+			compileglob(assign->u[1].p);
+			emitop(opLetBind);
+			pop(2);
+		}
+		emitop(opLetEnd);
+		bpop();
+		compilestmt(tree->u[1].p, tail);
+		break;
+	case nMatch: case nExtract:
+		compileglob(tree->u[0].p);
+		compilepattern(tree->u[1].p);
+		emitop(tree->kind == nMatch ? opMatch : opExtract);
+		pop(2);
+		break;
+	case nLocal: case nFor:
+		emitop(opWalk);
+		emitt(tree);
+		emiti(tail);
+		break;
+	default:
+		failed = TRUE;
+		break;
+	}
+}
+
+/* compile -- build the code for a tree; it has no instructions if the tree is left to the walker */
+static Code *compile(Tree *tree, CodeRole role) {
+	Code *code;
+
+	buflen = 0;
+	depth = maxdepth = bdepth = maxbdepth = 0;
+	quoting = failed = FALSE;
+	switch (role) {
+	case codeStatement:
+		compilestmt(tree, TRUE);
+		break;
+	case codeList:
+		compilelist(tree, FALSE);
+		break;
+	case codeGlob:
+		compileglob(tree);
+		break;
+	case codeReturns:
+		failed = TRUE;
+		break;
+	}
+	emitop(opEnd);
+	if (maxdepth > MAXSLOTS || maxbdepth > MAXBINDINGS)
+		failed = TRUE;
+	if (failed)
+		buflen = 0;
+
+	code = ealloc(sizeof (Code) + buflen * sizeof (Inst));
+	code->tree = tree;
+	code->role = role;
+	code->throws = FALSE;
+	code->slots = maxdepth;
+	code->bindings = maxbdepth;
+	code->quoting = quoting;
+	code->len = buflen;
+	memcpy(code->inst, buf, buflen * sizeof (Inst));
+	return code;
+}
+
+
+/*
+ * the code cache
+ *	a chained hash table keyed by the tree's address and the role
+ *	the code was compiled for.  trees the compiler leaves alone are
+ *	remembered too, so they are not compiled again.
+ */
+
+static Code **codetable = NULL;
+static int codesize = 0, codecount = 0;
+
+#define	CODEHASH(tree, role, size) \
+	((((size_t) (tree) >> 3) * 3 + (role)) & ((size) - 1))
+
+/* rehashcode -- move the code to a table of a new size */
+static void rehashcode(int size) {
+	int i;
+	Code **old = codetable;
+	int oldsize = codesize;
+
+	codetable = ealloc(size * sizeof (Code *));
+	memzero(codetable, size * sizeof (Code *));
+	codesize = size;
+	for (i = 0; i < oldsize; i++) {
+		Code *code, *next;
+		for (code = old[i]; code != NULL; code = next) {
+			int h = CODEHASH(code->tree, code->role, size);
+			next = code->next;
+			code->next = codetable[h];
+			codetable[h] = code;
+		}
+	}
+	if (old != NULL)
+		efree(old);
+}
+
+/* findcode -- look up the code cached for a tree */
+static Code *findcode(Tree *tree, CodeRole role) {
+	Code *code;
+	if (codetable != NULL)
+		for (code = codetable[CODEHASH(tree, role, codesize)]; code != NULL; code = code->next)
+			if (code->tree == tree && code->role == role)
+				return code;
+	return NULL;
+}
+
+/* addcode -- cache the code for a sealed tree */
+static Code *addcode(Code *code) {
+	int h;
+	if (codecount >= codesize)
+		rehashcode(codesize == 0 ? 256 : codesize * 2);
+	h = CODEHASH(code->tree, code->role, codesize);
+	code->next = codetable[h];
+	codetable[h] = code;
+	++codecount;
+	return code;
+}
+
+/* getcode -- return the code for a tree, or NULL if it should be walked */
+extern Code *getcode(Tree *tree, CodeRole role) {
+	Code *code;
+
+	if (tree == NULL || tree->kind == nLocal || tree->kind == nFor)
+		return NULL;
+	if ((code = findcode(tree, role)) == NULL) {
+		/* only sealed trees are sure to keep their addresses */
+		if (!issealed(tree))
+			return NULL;
+		code = addcode(compile(tree, role));
+	}
+	return code->len == 0 ? NULL : code;
+}
+
+/*
+ * scanreturns -- could walking a tree throw a return?
+ *	calls, assignments (through settors) and local walk or evaluate
+ *	code without eval_return, so a return made there is thrown.
+ *	thunks and lambdas are left out: a lambda catches its own returns,
+ *	and eval() checks a thunk's body when it runs it.  anything else
+ *	which runs code without eval_return is a primitive, and prim()
+ *	catches returns for those.
+ */
+static Boolean scanreturns(Tree *tree) {
+	for (; tree != NULL; tree = tree->u[1].p)
+		switch (tree->kind) {
+		case nCall: case nAssign: case nLocal:
+			return TRUE;
+		case nWord: case nQword: case nPrim: case nThunk: case nLambda:
+			return FALSE;
+		case nVar:
+			return scanreturns(tree->u[0].p);
+		default:
+			if (scanreturns(tree->u[0].p))
+				return TRUE;
+			break;
+		}
+	return FALSE;
+}
+
+/* throwsreturn -- could walking a tree with eval_return still throw a return? */
+extern Boolean throwsreturn(Tree *tree) {
+	Code *code;
+
+	if (tree == NULL)
+		return FALSE;
+	if ((code = findcode(tree, codeReturns)) == NULL) {
+		if (!issealed(tree))
+			return scanreturns(tree);
+		code = ealloc(sizeof (Code));
+		code->tree = tree;
+		code->role = codeReturns;
+		code->slots = code->bindings = code->len = 0;
+		code->quoting = FALSE;
+		code->throws = scanreturns(tree);
+		addcode(code);
+	}
+	return code->throws;
+}
+
+/* sweepcode -- after the code space is compacted, free dead code and follow the rest */
+extern void sweepcode(void) {
+	int i;
+	Code *live = NULL, *code, *next;
+
+	for (i = 0; i < codesize; i++) {
+		for (code = codetable[i]; code != NULL; code = next) {
+			Tree *tree = codemoved(code->tree);
+			next = code->next;
+			if (tree == NULL) {
+				efree(code);
+				--codecount;
+				continue;
+			}
+			code->tree = tree;
+			if (code->len > 0) {
+				Inst *ip = code->inst;
+				while (ip->op != opEnd) {
+					const char *kind = operands[(ip++)->op];
+					for (; *kind != '\0'; kind++, ip++)
+						if (*kind == 's') {
+							ip->s = codemoved(ip->s);
+							assert(ip->s != NULL);
+						} else if (*kind == 't') {
+							ip->t = codemoved(ip->t);
+							assert(ip->t != NULL);
+						}
+				}
+			}
+			code->next = live;
+			live = code;
+		}
+		codetable[i] = NULL;
+	}
+	for (code = live; code != NULL; code = next) {
+		int h = CODEHASH(code->tree, code->role, codesize);
+		next = code->next;
+		code->next = codetable[h];
+		codetable[h] = code;
+	}
+}
+
+
+/*
+ * the machine
+ */
+
+/* addlist -- append a fresh list to the list in a slot */
+static void addlist(Slot *slot, List *list) {
+	if (list == NULL)
+		return;
+	if (slot->head == NULL)
+		slot->head = list;
+	else {
+		slot->tail->next = list;
+		gcremember(slot->tail);
+	}
+	for (; list->next != NULL; list = list->next)
+		;
+	slot->tail = list;
+}
+
+/* settail -- find the end of the lists in a slot */
+static void settail(Slot *slot) {
+	List *lp;
+	StrList *qp;
+	if ((lp = slot->head) != NULL)
+		for (; lp->next != NULL; lp = lp->next)
+			;
+	slot->tail = lp;
+	if ((qp = slot->qhead) != NULL)
+		for (; qp->next != NULL; qp = qp->next)
+			;
+	slot->qtail = qp;
+}
+
+/* runcode -- run compiled code, returning its result */
+extern List *runcode(Code *code, Binding *binding, int flags) {
+	Slot slot[MAXSLOTS];
+	Binding *bstack[MAXBINDINGS];
+	int i, sp = -1, bsp = 0, base = rootsp;
+	Inst *ip = code->inst;
+	Tree *tree = code->tree;
+	List *result = ltrue, *list;
+
+	ROOTPUSH(&tree);
+	ROOTPUSH(&binding);
+	ROOTPUSH(&result);
+	for (i = 0; i < code->slots; i++) {
+		slot[i].head = slot[i].tail = NULL;
+		slot[i].qhead = slot[i].qtail = NULL;
+		ROOTPUSH(&slot[i].head);
+		ROOTPUSH(&slot[i].tail);
+		if (code->quoting) {
+			ROOTPUSH(&slot[i].qhead);
+			ROOTPUSH(&slot[i].qtail);
+		}
+	}
+	for (i = 0; i < code->bindings; i++) {
+		bstack[i] = NULL;
+		ROOTPUSH(&bstack[i]);
+	}
+
+	/*
+	 * a collection can move anything which is not rooted, so values
+	 * are stored in their slots as soon as they are made, and operands
+	 * are read from the code, which sweepcode() keeps current.
+	 */
+
+	for (;;)
+		switch ((ip++)->op) {
+		case opNil:
+			++sp;
+			slot[sp].head = slot[sp].tail = NULL;
+			slot[sp].qhead = slot[sp].qtail = NULL;
+			break;
+		case opWord:
+			list = mklist(mkstr((ip++)->s), NULL);
+			++sp;
+			slot[sp].head = slot[sp].tail = list;
+			break;
+		case opRawWord:
+			list = mklist(mkstr((ip++)->s), NULL);
+			++sp;
+			slot[sp].head = slot[sp].tail = list;
+			slot[sp].qhead = slot[sp].qtail = mkstrlist(UNQUOTED, NULL);
+			break;
+		case opClosure:
+			list = mklist(mkterm(NULL, mkclosure((ip++)->t, binding)), NULL);
+			++sp;
+			slot[sp].head = slot[sp].tail = list;
+			break;
+		case opPrim:
+			list = mklist(mkterm(NULL, mkclosure((ip++)->t, NULL)), NULL);
+			++sp;
+			slot[sp].head = slot[sp].tail = list;
+			break;
+		case opVar: {
+			Ref(List *, names, slot[sp].head);
+			slot[sp].head = slot[sp].tail = NULL;
+			for (; names != NULL; names = names->next)
+				addlist(&slot[sp], listcopy(varlookup(getstr(names->term), binding)));
+			RefEnd(names);
+			break;
+		}
+		case opVarsubName:
+			if ((list = slot[sp].head) == NULL)
+				fail("es:glom", "null variable name in subscript");
+			if (list->next != NULL)
+				fail("es:glom", "multi-word variable name in subscript");
+			slot[sp].head = varlookup(getstr(list->term), binding);
+			slot[sp].tail = NULL;
+			break;
+		case opVarsub:
+			list = subscript(slot[sp - 1].head, slot[sp].head);
+			--sp;
+			slot[sp].head = list;
+			settail(&slot[sp]);
+			break;
+		case opConcat:
+			list = concat(slot[sp - 1].head, slot[sp].head);
+			--sp;
+			slot[sp].head = list;
+			settail(&slot[sp]);
+			break;
+		case opQconcat: {
+			List *l1 = slot[sp - 1].head, *l2 = slot[sp].head;
+			StrList *q1 = slot[sp - 1].qhead, *q2 = slot[sp].qhead;
+			/* qconcat() blocks collections before anything is allocated */
+			--sp;
+			slot[sp].qhead = NULL;
+			list = qconcat(l1, l2, q1, q2, &slot[sp].qhead);
+			slot[sp].head = list;
+			settail(&slot[sp]);
+			break;
+		}
+		case opAppend: case opQappend:
+			--sp;
+			if (slot[sp + 1].head == NULL)
+				break;
+			if (slot[sp].head == NULL) {
+				slot[sp] = slot[sp + 1];
+				break;
+			}
+			slot[sp].tail->next = slot[sp + 1].head;
+			gcremember(slot[sp].tail);
+			slot[sp].tail = slot[sp + 1].tail;
+			if (ip[-1].op == opQappend) {
+				slot[sp].qtail->next = slot[sp + 1].qhead;
+				gcremember(slot[sp].qtail);
+				slot[sp].qtail = slot[sp + 1].qtail;
+			}
+			break;
+		case opQuote: {
+			int n = length(slot[sp].head);
+			slot[sp].qhead = slot[sp].qtail = NULL;
+			for (i = 0; i < n; i++) {
+				slot[sp].qhead = mkstrlist(QUOTED, slot[sp].qhead);
+				if (slot[sp].qtail == NULL)
+					slot[sp].qtail = slot[sp].qhead;
+			}
+			break;
+		}
+		case opGlob:
+			list = glob(slot[sp].head, slot[sp].qhead);
+			slot[sp].head = list;
+			slot[sp].qhead = NULL;
+			settail(&slot[sp]);
+			break;
+		case opResult:
+			list = listcopy(result);
+			++sp;
+			slot[sp].head = list;
+			slot[sp].qhead = NULL;
+			settail(&slot[sp]);
+			break;
+		case opCheckNames:
+			if (slot[sp].head == NULL)
+				fail("es:assign", "null variable name");
+			break;
+		case opAssign:
+			sp -= 2;
+			result = assignvars(slot[sp + 1].head, slot[sp + 2].head, binding);
+			break;
+		case opLetBegin: case opSave:
+			bstack[bsp++] = binding;
+			break;
+		case opLetBind:
+			sp -= 2;
+			if (slot[sp + 1].head == NULL)
+				fail("es:let", "null variable name");
+			bstack[bsp - 1] = bindvars(slot[sp + 1].head, slot[sp + 2].head, bstack[bsp - 1]);
+			break;
+		case opLetEnd: case opRestore:
+			binding = bstack[--bsp];
+			break;
+		case opEval:
+			--sp;
+			result = eval(slot[sp + 1].head, binding, (ip++)->i ? flags : 0);
+			break;
+		case opWalk:
+			ip += 2;
+			result = walk(ip[-2].t, binding, ip[-1].i ? flags : 0);
+			break;
+		case opMatch:
+			sp -= 2;
+			result = listmatch(slot[sp + 1].head, slot[sp + 2].head, slot[sp + 2].qhead)
+				 ? ltrue : lfalse;
+			break;
+		case opExtract:
+			sp -= 2;
+			result = extractmatches(slot[sp + 1].head, slot[sp + 2].head, slot[sp + 2].qhead);
+			break;
+		case opTrue:
+			result = ltrue;
+			break;
+		case opEnd:
+			if (code->role == codeStatement)
+				assert(sp == -1);
+			else {
+				assert(sp == 0);
+				result = slot[0].head;
+			}
+			rootsp = base;
+			return result;
+		default:
+			panic("runcode: bad instruction %d", ip[-1].op);
+		}
+}
@@ -11,8 +11,18 @@
 #define FNV_OFFSET      14695981039346656037ULL
 #define FNV_PRIME       1099511628211ULL
 
-/* Special pointer value for deleted entries */
-#define DELETED_ENTRY   ((char*)1)
+/*
+ * Control bytes
+ *      every slot has a byte in an array after the table: a slot in use
+ *      holds 7 bits of its key's hash, so probing can skip most
+ *      mismatches without touching the table; the full hash is kept in
+ *      the slot itself, so string comparisons are only done on real
+ *      matches and the table can be rebuilt without rehashing anything.
+ */
+#define CTRL_EMPTY      0x80
+#define CTRL_DELETED    0xFE
+#define CTRL_TAG(h)     ((unsigned char) (((h) >> 24) & 0x7F))
+#define IS_TAG(c)       ((c) < 0x80)
 
 /*
  * FNV-1a hash functions
@@ -41,27 +51,10 @@ static unsigned long strhash2(const char *first_string, const char *second_strin
     return hash_value;
 }
 
-static unsigned long strhash(const char *string)
+extern unsigned long strhash(const char *string)
 {   return strhash2(string, NULL);
 }
 
-/*
- * Helper functions for entry state checking
- */
-
-static inline Boolean is_deleted_entry(const char *entry_name)
-{   return entry_name == DELETED_ENTRY;
-}
-
-static inline Boolean is_empty_entry(const char *entry_name) __attribute__((unused));
-static inline Boolean is_empty_entry(const char *entry_name)
-{   return entry_name == NULL;
-}
-
-static inline Boolean is_valid_entry(const char *entry_name)
-{   return entry_name != NULL && entry_name != DELETED_ENTRY;
-}
-
 /*
  * Data structures and garbage collection
  */
@@ -71,28 +64,35 @@ DefineTag(Dict, static);
 typedef struct
 {   char *name;
     void *value;
+    unsigned long hash;
 } Assoc;
 
 struct Dict
 {   int   size;
-    int   remain;
-    Assoc table[1];  /* variable length */
+    int   remain;    /* empty slots which may still be used */
+    int   count;     /* entries in use */
+    Assoc table[1];  /* variable length, followed by the control bytes */
 };
 
+#define CONTROL(dict)   ((unsigned char *) &(dict)->table[(dict)->size])
+#define DICTSIZE(n)     (offsetof(Dict, table[n]) + (n))
+
 static Dict *mkdict0(int initial_size)
-{   size_t  allocation_length = offsetof(Dict, table[initial_size]);
+{   size_t  allocation_length = DICTSIZE(initial_size);
     Dict   *new_dict          = gcalloc(allocation_length, &DictTag);
     
-    memzero(new_dict, allocation_length);
+    memzero(new_dict, offsetof(Dict, table[initial_size]));
     new_dict->size   = initial_size;
+    memset(CONTROL(new_dict), CTRL_EMPTY, initial_size);
     new_dict->remain = REMAIN(initial_size);
+    new_dict->count  = 0;
  
     return new_dict;
 }
 
 static void *DictCopy(void *original_ptr)
 {   Dict   *original_dict     = original_ptr;
-    size_t  allocation_length = offsetof(Dict, table[original_dict->size]);
+    size_t  allocation_length = DICTSIZE(original_dict->size);
     void   *new_ptr           = gcalloc(allocation_length, &DictTag);
     
     memcpy(new_ptr, original_ptr, allocation_length);
@@ -108,89 +108,111 @@ static size_t DictScan(void *dict_ptr)
         current_assoc->name  = forward(current_assoc->name);
         current_assoc->value = forward(current_assoc->value);
     }
-    return offsetof(Dict, table[current_dict->size]);
+    return DICTSIZE(current_dict->size);
 }
 
 /*
  * Private operations
  */
 
-static Assoc *get(Dict *dictionary, const char *lookup_name)
-{   unsigned  long hash_value = strhash(lookup_name);
-    unsigned  long table_mask = dictionary->size - 1;
-    Assoc    *current_entry;
+static Assoc *get(Dict *dictionary, const char *lookup_name, unsigned long hash_value)
+{   unsigned  long table_mask = dictionary->size - 1;
+    unsigned  long position   = hash_value & table_mask;
+    unsigned  char tag        = CTRL_TAG(hash_value);
+    unsigned  char *control   = CONTROL(dictionary);
     
-    for (; (current_entry = &dictionary->table[hash_value & table_mask])->name != NULL; hash_value++)
-    {   if (!is_deleted_entry(current_entry->name) && streq(lookup_name, current_entry->name))
+    for (; control[position] != CTRL_EMPTY; position = (position + 1) & table_mask)
+    {   Assoc *current_entry = &dictionary->table[position];
+        if (control[position] == tag && (current_entry->name == lookup_name
+            || (current_entry->hash == hash_value && streq(lookup_name, current_entry->name))))
             return current_entry;
     }
     return NULL;
 }
 
-static void recurseput(void *, char *, void *);
-
-static Dict *put(Dict *dictionary, char *entry_name, void *entry_value)
-{   unsigned  long hash_value;
-    unsigned  long table_mask;
+/* insert -- add an entry known not to be present to a dictionary with room for it */
+static void insert(Dict *dictionary, char *entry_name, void *entry_value, unsigned long hash_value)
+{   unsigned  long table_mask = dictionary->size - 1;
+    unsigned  long position   = hash_value & table_mask;
+    unsigned  char *control   = CONTROL(dictionary);
     Assoc    *target_entry;
     
-    assert(get(dictionary, entry_name) == NULL);
-    assert(entry_value                 != NULL);
+    for (; IS_TAG(control[position]); position = (position + 1) & table_mask)
+        ;
+    if (control[position] == CTRL_EMPTY)
+        --dictionary->remain;
+    control[position] = CTRL_TAG(hash_value);
+    ++dictionary->count;
 
-    if (dictionary->remain <= 1)
-    {   Dict *new_dictionary;
-        Ref(Dict *, old_dictionary, dictionary);
-        Ref(char *, name_ptr,       entry_name);
-        Ref(void *, value_ptr,      entry_value);
-        
-        new_dictionary = mkdict0(GROW(old_dictionary->size));
-        dictforall(old_dictionary, recurseput, new_dictionary);
-        dictionary  = new_dictionary;
-        entry_name  = name_ptr;
-        entry_value = value_ptr;
-        RefEnd3(value_ptr, name_ptr, old_dictionary);
-    }
+    target_entry        = &dictionary->table[position];
+    target_entry->name  = entry_name;
+    target_entry->value = entry_value;
+    target_entry->hash  = hash_value;
+}
 
-    hash_value = strhash(entry_name);
-    table_mask = dictionary->size - 1;
+/* rebuild -- copy a dictionary into a new table with room for extra more entries */
+static Dict *rebuild(Dict *dictionary, int extra)
+{   Dict *new_dictionary;
+    int   new_size = dictionary->size;
+    int   table_index;
     
-    for (; (target_entry = &dictionary->table[hash_value & table_mask])->name != DELETED_ENTRY; hash_value++)
-    {   if (target_entry->name == NULL)
-        {   --dictionary->remain;
-            break;
+    /* without enough entries in use, just clear out the deleted slots */
+    while ((dictionary->count + extra) * 2 > REMAIN(new_size))
+        new_size = GROW(new_size);
+
+    Ref(Dict *, old_dictionary, dictionary);
+    new_dictionary = mkdict0(new_size);
+    for (table_index = 0; table_index < old_dictionary->size; table_index++)
+        if (IS_TAG(CONTROL(old_dictionary)[table_index]))
+        {   Assoc *old_entry = &old_dictionary->table[table_index];
+            insert(new_dictionary, old_entry->name, old_entry->value, old_entry->hash);
         }
+    RefEnd(old_dictionary);
+    return new_dictionary;
+}
+
+static Dict *put(Dict *dictionary, char *entry_name, void *entry_value, unsigned long hash_value)
+{   assert(get(dictionary, entry_name, hash_value) == NULL);
+    assert(entry_value                             != NULL);
+
+    if (dictionary->remain <= 1)
+    {   Ref(char *, name_ptr,  entry_name);
+        Ref(void *, value_ptr, entry_value);
+        dictionary  = rebuild(dictionary, 1);
+        entry_name  = name_ptr;
+        entry_value = value_ptr;
+        RefEnd2(value_ptr, name_ptr);
     }
 
-    target_entry->name  = entry_name;
-    target_entry->value = entry_value;
+    insert(dictionary, entry_name, entry_value, hash_value);
+    gcremember(dictionary);
 			
     return dictionary;
 }
 
-static void recurseput(void *dict_ptr, char *name_str, void *value_ptr)
-{   put(dict_ptr, name_str, value_ptr);
-}
-
 static void rm(Dict *dictionary, Assoc *target_entry)
 {   unsigned  long probe_position;
     unsigned  long table_mask;
-    Assoc    *probe_entry;
+    unsigned  char *control = CONTROL(dictionary);
     
     assert(dictionary->table <= target_entry && target_entry < &dictionary->table[dictionary->size]);
 
-    target_entry->name  = DELETED_ENTRY;
+    target_entry->name  = NULL;
     target_entry->value = NULL;
     probe_position      = target_entry - dictionary->table;
     table_mask          = dictionary->size - 1;
+    control[probe_position] = CTRL_DELETED;
+    --dictionary->count;
     
-    for (probe_position++; (probe_entry = &dictionary->table[probe_position & table_mask])->name == DELETED_ENTRY; probe_position++)
+    for (probe_position++; control[probe_position & table_mask] == CTRL_DELETED; probe_position++)
         ;
  
-    if (probe_entry->name != NULL)
+    if (control[probe_position & table_mask] != CTRL_EMPTY)
         return;
         
-    for (probe_position--; (probe_entry = &dictionary->table[probe_position & table_mask])->name == DELETED_ENTRY; probe_position--)
-    {   probe_entry->name = NULL;
+    /* the deleted run ends a probe sequence, so nothing needs it any more */
+    for (probe_position--; control[probe_position & table_mask] == CTRL_DELETED; probe_position--)
+    {   control[probe_position & table_mask] = CTRL_EMPTY;
         ++dictionary->remain;
     }
 }
@@ -203,8 +225,20 @@ extern Dict *mkdict(void)
 {   return mkdict0(INIT_DICT_SIZE);
 }
 
+/* dictsize -- the number of bytes a dictionary occupies in the heap */
+extern size_t dictsize(Dict *dictionary)
+{   return DICTSIZE(dictionary->size);
+}
+
+/* dictreserve -- make room for count more entries, so a bulk load grows the table once */
+extern Dict *dictreserve(Dict *dictionary, int count)
+{   if (dictionary->remain <= count)
+        dictionary = rebuild(dictionary, count + 1);
+    return dictionary;
+}
+
 extern void *dictget(Dict *dictionary, const char *lookup_name)
-{   Assoc *found_entry = get(dictionary, lookup_name);
+{   Assoc *found_entry = get(dictionary, lookup_name, strhash(lookup_name));
     
     if (found_entry == NULL)
         return NULL;
@@ -213,14 +247,17 @@ extern void *dictget(Dict *dictionary, const char *lookup_name)
 }
 
 extern Dict *dictput(Dict *dictionary, char *entry_name, void *entry_value)
-{   Assoc *existing_entry = get(dictionary, entry_name);
+{   unsigned long hash_value     = strhash(entry_name);
+    Assoc        *existing_entry = get(dictionary, entry_name, hash_value);
     
     if (entry_value != NULL)
     {   if (existing_entry == NULL)
-            dictionary = put(dictionary, entry_name, entry_value);
+            dictionary = put(dictionary, entry_name, entry_value, hash_value);
 		
         else
-            existing_entry->value = entry_value;
+        {   existing_entry->value = entry_value;
+            gcremember(dictionary);
+        }
     }
 
     else if (existing_entry != NULL)
@@ -237,7 +274,7 @@ extern void dictforall(Dict *target_dict, void (*processor_func)(void *, char *,
     for (table_index = 0; table_index < dictionary_ref->size; table_index++)
     {   Assoc *current_entry = &dictionary_ref->table[table_index];
         
-        if (is_valid_entry(current_entry->name))
+        if (IS_TAG(CONTROL(dictionary_ref)[table_index]))
             (*processor_func)(argument_ref, current_entry->name, current_entry->value);
     }
     RefEnd2(argument_ref, dictionary_ref);
@@ -246,10 +283,14 @@ extern void dictforall(Dict *target_dict, void (*processor_func)(void *, char *,
 extern void *dictget2(Dict *dictionary, const char *first_name, const char *second_name)
 {   unsigned  long hash_value = strhash2(first_name, second_name);
     unsigned  long table_mask = dictionary->size - 1;
-    Assoc    *current_entry;
+    unsigned  long position   = hash_value & table_mask;
+    unsigned  char tag        = CTRL_TAG(hash_value);
+    unsigned  char *control   = CONTROL(dictionary);
     
-    for (; (current_entry = &dictionary->table[hash_value & table_mask])->name != NULL; hash_value++)
-    {   if (!is_deleted_entry(current_entry->name) && streq2(current_entry->name, first_name, second_name))
+    for (; control[position] != CTRL_EMPTY; position = (position + 1) & table_mask)
+    {   Assoc *current_entry = &dictionary->table[position];
+        if (control[position] == tag && current_entry->hash == hash_value
+            && streq2(current_entry->name, first_name, second_name))
             return current_entry->value;
     }
     return NULL;
@@ -308,6 +308,7 @@ extern void runinitial(void) {
 
 	print("\nextern void runinitial(void) {\n");
 	print("\tint i;\n");
+	print("\treservevars(sizeof defs / sizeof defs[0] - 1);\n");
 	print("\tfor (i = 0; defs[i].name != NULL; i++)\n");
 	print("\t\tvardef((char *) defs[i].name, NULL, (List *) defs[i].value);\n");
 	print("}\n");
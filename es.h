@@ -152,9 +152,11 @@ extern Binding *reversebindings(Binding *binding);
 extern Binding *bindargs(Tree *params, List *args, Binding *binding);
 extern List *forkexec(char *file, List *list, Boolean inchild);
 extern List *walk(Tree *tree, Binding *binding, int flags);
+extern List *assignvars(List *vars, List *values, Binding *binding);
+extern Binding *bindvars(List *vars, List *values, Binding *binding);
 extern List *eval(List *list, Binding *binding, int flags);
 extern List *eval1(Term *term, int flags);
-extern List *pathsearch(Term *term);
+extern List *pathsearch(Term *term, int flags);
 
 extern unsigned long evaldepth, maxevaldepth;
 #define	MINmaxevaldepth		100
@@ -162,13 +164,40 @@ extern unsigned long evaldepth, maxevaldepth;
 
 #define	eval_inchild		1
 #define	eval_exitonfalse	2
+/* eval_tail, eval_return and eval_break stay clear of the run_* flags below */
+#define	eval_tail		128	/* the result is passed straight back to a lambda */
+#define	eval_return		256	/* so is a return, which the caller checks for */
+#define	eval_break		512	/* and a break, which the enclosing loop checks for */
 #define	eval_flags		(eval_inchild|eval_exitonfalse)
+#define	eval_unwinding		(eval_return|eval_break)
+
+extern List tailcallmark, returnmark, breakmark;	/* results which unwind without throwing */
+#define	isunwinding(list) \
+	((list) == &tailcallmark || (list) == &returnmark || (list) == &breakmark)
+extern List *evalreturn(List *value);
+extern List *evalbreak(List *value);
+extern List *unwound(void);
+extern List *walkbody(Tree *tree, Binding *binding, int flags);
 
 
 /* glom.c */
 
 extern List *glom(Tree *tree, Binding *binding, Boolean globit);
 extern List *glom2(Tree *tree, Binding *binding, StrList **quotep);
+extern List *concat(List *list1, List *list2);
+extern List *qconcat(List *list1, List *list2, StrList *quote1, StrList *quote2, StrList **quotep);
+extern List *subscript(List *list, List *subs);
+
+
+/* code.c */
+
+typedef struct Code Code;
+typedef enum { codeStatement, codeList, codeGlob, codeReturns } CodeRole;
+
+extern Code *getcode(Tree *tree, CodeRole role);	/* NULL if the tree should be walked */
+extern Boolean throwsreturn(Tree *tree);
+extern List *runcode(Code *code, Binding *binding, int flags);
+extern void sweepcode(void);
 
 
 /* glob.c */
@@ -187,6 +216,7 @@ extern List *extractmatches(List *subjects, List *patterns, StrList *quotes);
 /* var.c */
 
 extern void initvars(void);
+extern void reservevars(int count);
 extern void initenv(char **envp, Boolean protected);
 extern void hidevariables(void);
 extern void validatevar(const char *var);
@@ -195,9 +225,12 @@ extern List *varlookup2(char *name1, char *name2, Binding *binding);
 extern void vardef(char *, Binding *, List *);
 extern Vector *mkenv(void);
 extern void setnoexport(List *list);
+extern void setfunctiontable(char *dir);
+extern void sharefntable(void);
 extern void addtolist(void *arg, char *key, void *value);
 extern List *listvars(Boolean internal);
 extern List *varswithprefix(char *prefix);
+extern List *varcensus(void);
 
 typedef struct Push Push;
 extern Push *pushlist;
@@ -227,6 +260,7 @@ extern pid_t spgrp(pid_t pgid);
 extern int tctakepgrp(void);
 extern void initpgrp(void);
 extern int ewait(int pid, Boolean interruptible);
+extern Boolean haschildren(void);
 #define	ewaitfor(pid)	ewait(pid, FALSE)
 
 #if JOB_PROTECT
@@ -241,10 +275,13 @@ extern Noreturn esexit(int);
 
 typedef struct Dict Dict;
 extern Dict *mkdict(void);
+extern size_t dictsize(Dict *dict);
+extern Dict *dictreserve(Dict *dict, int count);
 extern void dictforall(Dict *dict, void (*proc)(void *, char *, void *), void *arg);
 extern void *dictget(Dict *dict, const char *name);
 extern Dict *dictput(Dict *dict, char *name, void *value);
 extern void *dictget2(Dict *dict, const char *name1, const char *name2);
+extern unsigned long strhash(const char *s);
 
 
 /* conv.c */
@@ -272,6 +309,8 @@ extern StrList *mkstrlist(char *, StrList *);
 extern Vector *mkvector(int n);
 extern Vector *vectorize(List *list);
 extern void sortvector(Vector *v);
+extern Vector *sortedinsert(Vector *v, char *s);
+extern Boolean sortedremove(Vector *v, const char *s);
 
 
 /* util.c */
@@ -354,7 +393,7 @@ extern int signumber(const char *name);
 extern char *signame(int sig);
 extern char *sigmessage(int sig);
 
-#define	SIGCHK() sigchk()
+#define	SIGCHK()	STMT(if (gcoverlimit) gcheapfail(); sigchk())
 typedef enum {
 	sig_nochange, sig_catch, sig_default, sig_ignore, sig_noop, sig_special
 } Sigeffect;
@@ -389,24 +428,63 @@ extern const char * const version;
 /* gc.c -- see gc.h for more */
 
 typedef struct Tag Tag;
-#define	gcnew(type)	((type *) gcalloc(sizeof (type), &(CONCAT(type,Tag))))
 
 extern void *gcalloc(size_t n, Tag *t);		/* allocate n with collection tag t */
 extern char *gcdup(const char *s);		/* copy a 0-terminated string into gc space */
 extern char *gcndup(const char *s, size_t n);	/* copy a counted string into gc space */
+extern size_t gcstrlen(const char *s);		/* strlen(), using the gc header if s has one */
 
 extern void initgc(void);			/* must be called at the dawn of time */
 extern void gc(void);				/* provoke a collection, if enabled */
+extern void gcshrinkheap(void);			/* collect, and return memory to the system */
+extern void gcidle(void);			/* collect early while waiting for input */
 extern void gcreserve(size_t nbytes);		/* provoke a collection, if enabled and not enough space */
 extern void gcenable(void);			/* enable collections */
 extern void gcdisable(void);			/* disable collections */
 extern Boolean gcisblocked(void);		/* is collection disabled? */
+extern void gcremember(void *p);		/* write barrier: a pointer has been stored in p */
+
+/* collector statistics, for $&gcstats */
+typedef struct {
+	unsigned long collections, majors;	/* number of collections, and how many were major */
+	unsigned long copied;			/* bytes copied by the collector */
+	unsigned long pausetotal, pausemax;	/* time spent collecting, in microseconds */
+	unsigned long pseals;			/* number of calls to pseal() */
+	size_t nursery, tenured, pspace, code;	/* current sizes of the spaces */
+	size_t large;				/* bytes in the large object space */
+	size_t frozen;				/* bytes inherited from the parent process */
+	size_t peak;				/* largest total heap size seen */
+} GCStats;
+
+extern void gcstats(GCStats *stats);
+typedef struct {
+	char *name;				/* the type of the objects */
+	unsigned long count;			/* how many are reachable */
+	size_t bytes;				/* their size, headers included */
+} GCCensus;
+
+extern int gccensus(GCCensus *census, int max);	/* tally the live heap by type */
+extern size_t gcreachable(void *p);		/* bytes reachable from p */
+extern void gcfreeze(void);			/* in a child, stop collecting the parent's heap */
+
+/* collector sizing policy, set through $&setgcgrowth and friends */
+extern unsigned long gcgrowth, gcshrink, gcminspace, gcmaxpause;
+extern unsigned long gcmaxheap;			/* max-heap-size, or 0 */
+extern Boolean gcoverlimit;			/* live data is over gcmaxheap */
+extern Noreturn gcheapfail(void);		/* throw the error for gcoverlimit */
+extern unsigned long gcgeneration;		/* bumped whenever objects may have moved */
+#define	DEFgcgrowth		4
+#define	DEFgcshrink		12
+#define	DEFgcminspace		10000
+#define	DEFgcmaxpause		0
+#define	MINgcminspace		1000
 
 /* operations with pspace, the explicitly-collected gc space for parse tree building */
 extern void *palloc(size_t n, Tag *t);		/* allocate n with collection tag t, but in pspace */
 extern void *pseal(void *p);			/* collect pspace into gcspace with root p */
 extern char *pdup(const char *s);		/* copy a 0-terminated string into pspace */
 extern char *pndup(const char *s, size_t n);	/* copy a counted string into pspace */
+extern char *intern(char *s);			/* the copy of s shared by sealed code, or s */
 
 
 /*
@@ -419,7 +497,20 @@ struct Root {
 	Root *next;
 };
 
-extern Root *rootlist;
+/*
+ * the root stack
+ *	Ref() pushes the address of a local variable onto rootstack and
+ *	RefEnd() pops it again; a collection forwards every pointer the
+ *	stack refers to.  pushes and pops must nest.
+ */
+
+extern void ***rootstack;
+extern int rootsp, rootmax;
+extern void growrootstack(void);
+
+#define	ROOTPUSH(addr) \
+	((rootsp < rootmax ? (void) 0 : growrootstack()), \
+	 rootstack[rootsp++] = (void **) (addr))
 
 #if REF_ASSERTIONS
 #define	refassert(e)	assert(e)
@@ -430,14 +521,10 @@ extern Root *rootlist;
 #define	Ref(t, v, init) \
 	if (0) ; else { \
 		t v = init; \
-		Root (CONCAT(v,__root__)); \
-		(CONCAT(v,__root__)).p = (void **) &v; \
-		(CONCAT(v,__root__)).next = rootlist; \
-		rootlist = &(CONCAT(v,__root__))
+		ROOTPUSH(&v)
 #define	RefPop(v) \
-		refassert(rootlist == &(CONCAT(v,__root__))); \
-		refassert(rootlist->p == (void **) &v); \
-		rootlist = rootlist->next;
+		refassert(rootstack[rootsp - 1] == (void **) &v); \
+		--rootsp;
 #define RefEnd(v) \
 		RefPop(v); \
 	}
@@ -447,14 +534,10 @@ extern Root *rootlist;
 	}
 #define	RefAdd(e) \
 	if (0) ; else { \
-		Root __root__; \
-		__root__.p = (void **) &e; \
-		__root__.next = rootlist; \
-		rootlist = &__root__
+		ROOTPUSH(&e)
 #define	RefRemove(e) \
-		refassert(rootlist == &__root__); \
-		refassert(rootlist->p == (void **) &e); \
-		rootlist = rootlist->next; \
+		refassert(rootstack[rootsp - 1] == (void **) &e); \
+		--rootsp; \
 	}
 
 #define	RefEnd2(v1, v2)		RefEnd(v1); RefEnd(v2)
@@ -485,7 +568,7 @@ struct Push {
 	char *name;
 	List *defn;
 	int flags;
-	Root nameroot, defnroot;
+	int rootsp;				/* root stack height with name and defn pushed */
 };
 
 
@@ -503,7 +586,7 @@ struct Push {
 typedef struct Handler Handler;
 struct Handler {
 	Handler *up;
-	Root *rootlist;
+	int rootsp;
 	Push *pushlist;
 	unsigned long evaldepth;
 	jmp_buf label;
@@ -525,7 +608,7 @@ extern List *raised(List *e);
 #define ExceptionHandler \
 	{ \
 		Handler _localhandler; \
-		_localhandler.rootlist = rootlist; \
+		_localhandler.rootsp = rootsp; \
 		_localhandler.pushlist = pushlist; \
 		_localhandler.evaldepth = evaldepth; \
 		_localhandler.up = tophandler; \
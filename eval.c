@@ -45,7 +45,34 @@ extern List *forkexec(char *file, List *list, Boolean inchild) {
 	return mklist(mkterm(mkstatus(status), NULL), NULL);
 }
 
-/* assign -- bind a list of values to a list of variables */
+/* assignvars -- bind a list of values to a list of variables */
+extern List *assignvars(List *vars0, List *values0, Binding *binding0) {
+	Ref(List *, result, values0);
+	Ref(List *, vars, vars0);
+	Ref(List *, values, values0);
+	Ref(Binding *, binding, binding0);
+
+	for (; vars != NULL; vars = vars->next) {
+		List *value;
+		Ref(char *, name, getstr(vars->term));
+		if (values == NULL)
+			value = NULL;
+		else if (vars->next == NULL || values->next == NULL) {
+			value = values;
+			values = NULL;
+		} else {
+			value = mklist(values->term, NULL);
+			values = values->next;
+		}
+		vardef(name, binding, value);
+		RefEnd(name);
+	}
+
+	RefEnd3(binding, values, vars);
+	RefReturn(result);
+}
+
+/* assign -- evaluate and bind a list of values to a list of variables */
 static List *assign(Tree *varform, Tree *valueform0, Binding *binding0) {
 	Ref(List *, result, NULL);
 
@@ -57,7 +84,17 @@ static List *assign(Tree *varform, Tree *valueform0, Binding *binding0) {
 		fail("es:assign", "null variable name");
 
 	Ref(List *, values, glom(valueform, binding, TRUE));
-	result = values;
+	result = assignvars(vars, values, binding);
+
+	RefEnd4(values, vars, binding, valueform);
+	RefReturn(result);
+}
+
+/* bindvars -- add let-bound variables to a Binding */
+extern Binding *bindvars(List *vars0, List *values0, Binding *binding0) {
+	Ref(Binding *, binding, binding0);
+	Ref(List *, vars, vars0);
+	Ref(List *, values, values0);
 
 	for (; vars != NULL; vars = vars->next) {
 		List *value;
@@ -71,12 +108,12 @@ static List *assign(Tree *varform, Tree *valueform0, Binding *binding0) {
 			value = mklist(values->term, NULL);
 			values = values->next;
 		}
-		vardef(name, binding, value);
+		binding = mkbinding(name, value, binding);
 		RefEnd(name);
 	}
 
-	RefEnd4(values, vars, binding, valueform);
-	RefReturn(result);
+	RefEnd2(values, vars);
+	RefReturn(binding);
 }
 
 /* letbindings -- create a new Binding containing let-bound variables */
@@ -99,21 +136,7 @@ static Binding *letbindings(Tree *defn0, Binding *outer0,
 		if (vars == NULL)
 			fail("es:let", "null variable name");
 
-		for (; vars != NULL; vars = vars->next) {
-			List *value;
-			Ref(char *, name, getstr(vars->term));
-			if (values == NULL)
-				value = NULL;
-			else if (vars->next == NULL || values->next == NULL) {
-				value = values;
-				values = NULL;
-			} else {
-				value = mklist(values->term, NULL);
-				values = values->next;
-			}
-			binding = mkbinding(name, value, binding);
-			RefEnd(name);
-		}
+		binding = bindvars(vars, values, binding);
 
 		RefEnd3(values, vars, assign);
 	}
@@ -122,6 +145,21 @@ static Binding *letbindings(Tree *defn0, Binding *outer0,
 	RefReturn(binding);
 }
 
+/*
+ * varpopmarked -- varpop, keeping a return or break passing through intact
+ *	*resultp must be a root made before the push.
+ */
+static void varpopmarked(Push *p, List **resultp) {
+	List *mark = *resultp;
+	if (mark == &returnmark || mark == &breakmark) {
+		/* a settor may make returns of its own, which would clobber the value */
+		*resultp = unwound();
+		varpop(p);
+		*resultp = mark == &returnmark ? evalreturn(*resultp) : evalbreak(*resultp);
+	} else
+		varpop(p);
+}
+
 /* localbind -- recursively convert a Bindings list into dynamic binding */
 static List *localbind(Binding *dynamic0, Binding *lexical0,
 		       Tree *body0, int evalflags) {
@@ -135,8 +173,10 @@ static List *localbind(Binding *dynamic0, Binding *lexical0,
 		Ref(Binding *, lexical, lexical0);
 
 		varpush(&p, dynamic->name, dynamic->defn);
-		result = localbind(dynamic->next, lexical, body, evalflags);
-		varpop(&p);
+		/* a return or break still passes through: varpop runs on the way out */
+		result = localbind(dynamic->next, lexical, body,
+				   evalflags &~ eval_tail);
+		varpopmarked(&p, &result);
 
 		RefEnd3(lexical, dynamic, body);
 		RefReturn(result);
@@ -206,6 +246,7 @@ static List *forloop(Tree *defn0, Tree *body0,
 					value = mklist(sequence->defn->term,
 						       NULL);
 					sequence->defn = sequence->defn->next;
+					gcremember(sequence);
 					allnull = FALSE;
 				}
 				bp = mkbinding(lp->name, value, bp);
@@ -216,8 +257,16 @@ static List *forloop(Tree *defn0, Tree *body0,
 				RefPop(bp);
 				break;
 			}
-			result = walk(body, bp, evalflags & eval_exitonfalse);
+			result = walk(body, bp,
+				      (evalflags & (eval_exitonfalse|eval_return))
+				      | eval_break);
 			RefEnd(bp);
+			if (result == &breakmark) {
+				result = unwound();
+				break;
+			}
+			if (result == &returnmark)
+				break;
 			SIGCHK();
 		}
 
@@ -267,6 +316,7 @@ static List *extractpattern(Tree *subjectform0, Tree *patternform0,
 extern List *walk(Tree *tree0, Binding *binding0, int flags) {
 	Tree *volatile tree = tree0;
 	Binding *volatile binding = binding0;
+	Code *code;
 
 	SIGCHK();
 
@@ -274,6 +324,9 @@ top:
 	if (tree == NULL)
 		return ltrue;
 
+	if ((code = getcode(tree, codeStatement)) != NULL)
+		return runcode(code, binding, flags);
+
 	switch (tree->kind) {
 
 	    case nConcat: case nList: case nQword: case nVar: case nVarsub:
@@ -346,7 +399,7 @@ extern Binding *bindargs(Tree *params, List *args, Binding *binding) {
 }
 
 /* pathsearch -- evaluate fn %pathsearch + some argument */
-extern List *pathsearch(Term *term) {
+extern List *pathsearch(Term *term, int flags) {
 	List *list;
 	Ref(List *, search, NULL);
 	search = varlookup("fn-%pathsearch", NULL);
@@ -355,7 +408,108 @@ extern List *pathsearch(Term *term) {
 	list = mklist(term, NULL);
 	list = append(search, list);
 	RefEnd(search);
-	return eval(list, NULL, 0);
+	return eval(list, NULL, flags & eval_return);
+}
+
+/*
+ * tail calls and returns
+ *	a lambda walks its body with eval_tail and eval_return.  a call
+ *	to a lambda made with eval_tail, whose result would only be passed
+ *	straight back, is instead handed back to the enclosing lambda to
+ *	make in its place, so tail recursion runs in constant stack.  a
+ *	return made with eval_return is handed back the same way rather
+ *	than thrown: the primitives which pass eval_return on stop as soon
+ *	as they see the mark.  loops walk their bodies with eval_break, and
+ *	a break is handed back to the loop in the same way.  anything else
+ *	clears the flags, and a return or break made there is thrown.
+ *
+ *	a thrown return is caught as close as possible to where the flag
+ *	was cleared and handed back as returnmark from there, so a lambda
+ *	only needs a handler when its own body could throw one.  walkbody()
+ *	catches for trees which throwsreturn() says may throw, and prim()
+ *	catches for primitives which may run code.
+ */
+
+List tailcallmark = { NULL, NULL }, returnmark = { NULL, NULL };
+List breakmark = { NULL, NULL };
+static List *pending = NULL;		/* the tail call or the unwound value */
+static char *pendingname = NULL;	/* the function name of the tail call */
+
+/* unwind -- leave a tail call or return for the enclosing lambda */
+static List *unwind(List *mark, List *list, char *name) {
+	static Boolean rooted = FALSE;
+	if (!rooted) {
+		globalroot(&pending);
+		globalroot(&pendingname);
+		rooted = TRUE;
+	}
+	pending = list;
+	pendingname = name;
+	return mark;
+}
+
+/* walkbody -- walk a lambda's or thunk's body, handing a thrown return back as returnmark */
+extern List *walkbody(Tree *tree, Binding *binding, int flags) {
+	List *volatile result = NULL;
+
+	if (!(flags & eval_return) || !throwsreturn(tree))
+		return walk(tree, binding, flags);
+
+	ExceptionHandler
+
+		result = walk(tree, binding, flags);
+
+	CatchException (e)
+
+		if (!termeq(e->term, "return"))
+			throw(e);
+		result = evalreturn(e->next);
+
+	EndExceptionHandler
+
+	return result;
+}
+
+/* glomclosure -- glom a list closure, handing a return thrown by a call in it back as returnmark */
+static List *glomclosure(Closure *closure, int flags) {
+	List *volatile result = NULL;
+
+	if (!(flags & eval_return) || !throwsreturn(closure->tree))
+		return glom(closure->tree, closure->binding, TRUE);
+
+	Ref(Closure *, cp, closure);
+
+	ExceptionHandler
+
+		result = glom(cp->tree, cp->binding, TRUE);
+
+	CatchException (e)
+
+		if (!termeq(e->term, "return"))
+			throw(e);
+		result = evalreturn(e->next);
+
+	EndExceptionHandler
+
+	RefEnd(cp);
+	return result;
+}
+
+/* evalreturn -- return a value from the enclosing lambda without throwing */
+extern List *evalreturn(List *value) {
+	return unwind(&returnmark, value, NULL);
+}
+
+/* evalbreak -- leave the enclosing loop without throwing */
+extern List *evalbreak(List *value) {
+	return unwind(&breakmark, value, NULL);
+}
+
+/* unwound -- the value of the return or break which was just handed back */
+extern List *unwound(void) {
+	List *value = pending;
+	pending = NULL;
+	return value;
 }
 
 /* eval -- evaluate a list, producing a list */
@@ -386,39 +540,63 @@ restart:
 			list = prim(cp->tree->u[0].s, list->next, binding, flags);
 			break;
 		    case nThunk:
-			list = walk(cp->tree->u[0].p, cp->binding, flags);
+			list = walkbody(cp->tree->u[0].p, cp->binding, flags);
 			break;
 		    case nLambda:
-			ExceptionHandler
-
+			if (flags & eval_tail) {
+				list = unwind(&tailcallmark, list, funcname);
+				RefPop3(funcname, binding, list);
+				--evaldepth;
+				return list;
+			}
+			{
 				Push p;
-				Ref(Tree *, tree, cp->tree);
-				Ref(Binding *, context,
-					       bindargs(tree->u[0].p,
-							list->next,
-							cp->binding));
-				if (funcname != NULL)
-					varpush(&p, "0",
-						    mklist(mkterm(funcname,
-								  NULL),
-							   NULL));
-				list = walk(tree->u[1].p, context, flags);
-				if (funcname != NULL)
-					varpop(&p);
-				RefEnd2(context, tree);
-	
-			CatchException (e)
-
-				if (termeq(e->term, "return")) {
-					list = e->next;
-					goto done;
+				Boolean pushed = FALSE;
+				Ref(Tree *, tree, NULL);
+				Ref(Binding *, context, NULL);
+				for (;;) {
+					tree = cp->tree;
+					context = bindargs(tree->u[0].p,
+							   list->next,
+							   cp->binding);
+					if (funcname != NULL) {
+						/* a tail call replaces its caller's $0 */
+						if (pushed)
+							varpop(&p);
+						varpush(&p, "0",
+							    mklist(mkterm(funcname,
+									  NULL),
+								   NULL));
+						pushed = TRUE;
+					}
+					list = walkbody(tree->u[1].p, context,
+							(flags &~ eval_break)
+							| eval_tail | eval_return);
+					if (list != &tailcallmark)
+						break;
+					/* make the tail call in this frame */
+					list = pending;
+					funcname = pendingname;
+					pending = NULL;
+					pendingname = NULL;
+					SIGCHK();
+					cp = getclosure(list->term);
+					assert(cp != NULL && cp->tree->kind == nLambda);
 				}
-				throw(e);
-
-			EndExceptionHandler
+				if (pushed)
+					varpopmarked(&p, &list);
+				RefEnd2(context, tree);
+				if (list == &returnmark)
+					list = unwound();
+			}
 			break;
 		    case nList: {
-			Ref(List *, lp, glom(cp->tree, cp->binding, TRUE));
+			Ref(List *, lp, glomclosure(cp, flags));
+			if (lp == &returnmark) {
+				list = lp;
+				RefPop(lp);
+				goto done;
+			}
 			list = append(lp, list->next);
 			RefEnd(lp);
 			goto restart;
@@ -463,7 +641,11 @@ restart:
 	}
 	RefEnd(name);
 
-	fn = pathsearch(list->term);
+	fn = pathsearch(list->term, flags);
+	if (fn == &returnmark) {
+		list = fn;
+		goto done;
+	}
 	if (fn != NULL && fn->next == NULL
 	    && (cp = getclosure(fn->term)) == NULL) {
 		char *name = getstr(fn->term);
@@ -478,7 +660,7 @@ restart:
 
 done:
 	--evaldepth;
-	if ((flags & eval_exitonfalse) && !istrue(list))
+	if ((flags & eval_exitonfalse) && !isunwinding(list) && !istrue(list))
 		esexit(exitstatus(list));
 	RefEnd2(funcname, binding);
 	RefReturn(list);
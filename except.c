@@ -12,7 +12,7 @@ Push *pushlist = NULL;
 /* pophandler -- remove a handler */
 extern void pophandler(Handler *handler) {
 	assert(tophandler == handler);
-	assert(handler->rootlist == rootlist);
+	assert(handler->rootsp == rootsp);
 	tophandler = handler->up;
 }
 
@@ -29,19 +29,15 @@ extern Noreturn throw(List *e) {
 		Root excroot;
 		exceptionroot(&excroot, &e);
 		while (pushlist != handler->pushlist) {
-			rootlist = &pushlist->defnroot;
+			rootsp = pushlist->rootsp;
 			varpop(pushlist);
 		}
 		exceptionunroot();
 	}
 	evaldepth = handler->evaldepth;
 
-#if ASSERTIONS
-	for (; rootlist != handler->rootlist; rootlist = rootlist->next)
-		assert(rootlist != NULL);
-#else
-	rootlist = handler->rootlist;
-#endif
+	assert(rootsp >= handler->rootsp);
+	rootsp = handler->rootsp;
 	exception = e;
 	longjmp(handler->label, 1);
 	NOTREACHED;
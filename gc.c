@@ -5,20 +5,18 @@
 #include "es.h"
 #include "gc.h"
 
-#define	ALIGN(n)	(((n) + sizeof (void *) - 1) &~ (sizeof (void *) - 1))
+#define	ALIGN(n)	GCALIGN(n)
 
-typedef struct Space Space;
-struct Space {
-	char *current, *bot, *top;
-	Space *next;
-};
+typedef struct {
+	void **table;
+	size_t size, count;
+} PtrSet;
 
 #define	SPACESIZE(sp)	(((sp)->top - (sp)->bot))
 #define	SPACEFREE(sp)	(((sp)->top - (sp)->current))
 #define	SPACEUSED(sp)	(((sp)->current - (sp)->bot))
 #define	INSPACE(p, sp)	((sp)->bot <= (char *) (p) && (char *) (p) < (sp)->top)
 
-#define	MIN_minspace	10000
 #define	MIN_minpspace	1000
 
 #if GCPROTECT
@@ -35,18 +33,36 @@ struct Space {
 
 
 /* globals */
-Root *rootlist;
+void ***rootstack = NULL;
+int rootsp = 0, rootmax = 0;
 int gcblocked = 0;
 Tag StringTag;
+Space *nursery;				/* allocation happens here; see gcnew() */
+unsigned long gcgrowth = DEFgcgrowth;		/* grow new space to this multiple of live data */
+unsigned long gcshrink = DEFgcshrink;		/* shrink new space to gcgrowth times live data past this multiple */
+unsigned long gcminspace = DEFgcminspace;	/* never shrink new space below this */
+unsigned long gcmaxpause = DEFgcmaxpause;	/* microseconds a minor collection may take, or 0 */
+unsigned long gcmaxheap = 0;			/* bytes of live data allowed, or 0 */
+unsigned long gcgeneration = 0;			/* counts collections and seals */
+Boolean gcoverlimit = FALSE;			/* set by a collection, thrown by SIGCHK() */
 
 /* own variables */
-static Space *new, *old, *pspace;
+static Space *old, *pspace;
+static Space *tenured, *oldtenured;	/* objects which have survived a collection */
+static Space *code, *oldcode;		/* sealed parse trees */
+static Space *frozen;			/* inherited from the parent; see gcfreeze() */
 #if GCPROTECT
 static Space *spaces;
 #endif
 static Root *globalrootlist, *exceptionrootlist;
-static size_t minspace = MIN_minspace;	/* minimum number of bytes in a new space */
+static size_t minspace = DEFgcminspace;	/* minimum number of bytes in a new space */
 static size_t minpspace = MIN_minpspace;
+static size_t tenuredlimit = DEFgcminspace;	/* tenured bytes which provoke a major collection */
+static size_t heaplive = 0;			/* live bytes found by the last major collection */
+static size_t heapfailed = 0;			/* heaplive when gcoverlimit was last set */
+static size_t minneeded = 0;			/* room the caller of collect() must get */
+static Boolean shrinking = FALSE;	/* is gcshrinkheap() collecting? */
+static GCStats stats;
 
 
 /*
@@ -65,13 +81,36 @@ static size_t minpspace = MIN_minpspace;
 #endif
 #endif
 
-#if GCPROTECT
-#if HAVE_MMAP
+#if HAVE_MMAP || HAVE_MADVISE
 #include <sys/mman.h>
 #endif
+#if HAVE_MALLOC_TRIM
+#include <malloc.h>
+#endif
 
 static int pagesize;
-#define	PAGEROUND(n)	((n) + pagesize - 1) &~ (pagesize - 1)
+#define	PAGEROUND(n)	(((n) + pagesize - 1) &~ (pagesize - 1))
+
+/* initmmu -- initialization for memory management calls */
+static void initmmu(void) {
+#if HAVE_SYSCONF
+	pagesize = sysconf(_SC_PAGESIZE);
+#else
+	pagesize = getpagesize();
+#endif
+}
+
+/* trimspace -- hand the pages in the unused tail of a space back to the system */
+static void trimspace(Space *space) {
+#if HAVE_MADVISE && defined(MADV_DONTNEED)
+	size_t bot = PAGEROUND((size_t) space->current);
+	size_t top = ((size_t) space->top) &~ (pagesize - 1);
+	if (bot < top)
+		madvise((void *) bot, top - bot, MADV_DONTNEED);
+#endif
+}
+
+#if GCPROTECT
 
 /* take -- allocate memory for a space */
 static void *take(size_t n) {
@@ -120,15 +159,6 @@ static void revalidate(void *p, size_t n) {
 		panic("mprotect(PROT_READ|PROT_WRITE): %s", esstrerror(errno));
 #endif
 }
-
-/* initmmu -- initialization for memory management calls */
-static void initmmu(void) {
-#if HAVE_SYSCONF
-	pagesize = sysconf(_SC_PAGESIZE);
-#else
-	pagesize = getpagesize();
-#endif
-}
 #endif	/* GCPROTECT */
 
 
@@ -275,43 +305,70 @@ extern void exceptionunroot(void) {
 	exceptionrootlist = exceptionrootlist->next;
 }
 
+/*
+ * object headers
+ *	every object is preceded by a header word, normally a pointer to
+ *	its Tag.  strings store their allocated length there instead, so
+ *	the collector never has to measure them.
+ */
+
 /* not portable to word addressed machines */
-#define	TAG(p)		(((Tag **) p)[-1])
+#define	HEADER(p)	(((Tag **) p)[-1])
 #define	FORWARDED(tagp)	(((size_t) tagp) & 1)
 #define	FOLLOWTO(p)	((Tag *) (((char *) p) + 1))
 #define	FOLLOW(tagp)	((void *) (((char *) tagp) - 1))
+#define	ISSTRHEADER(tagp)	(((size_t) tagp) & 2)
+#define	STRHEADER(n)	((Tag *) (((size_t) (n) << 2) | 2))
+#define	STRLENGTH(tagp)	(((size_t) tagp) >> 2)
+#define	TAG(p)		(ISSTRHEADER(HEADER(p)) ? &StringTag : HEADER(p))
+
+static Boolean marklarge(void *p);
+static void *copycode(Tag *tag, void *p);
+static void sweepsymbols(void);
+static void censusvisit(void *p);
 
 /* TODO: remove pmode: it's the Wrong Thing */
 static Boolean pmode = FALSE;
+static Boolean incensus = FALSE;	/* is the heap being walked rather than collected? */
 
 /* forward -- forward an individual pointer from old space */
 extern void *forward(void *p) {
-	Tag *tag;
+	Tag *tag, *header;
 	void *np;
 
+	if (incensus) {
+		censusvisit(p);
+		return p;
+	}
+
 	if (pmode && !isinspace(pspace, p)) {
 		VERBOSE(("GC %8ux : <<not in pspace>>\n", p));
 		return p;
 	}
 
-	if (!pmode && !isinspace(old, p)) {
-		VERBOSE(("GC %8ux : <<not in old space>>\n", p));
+	if (
+		!pmode && !isinspace(old, p) && !isinspace(oldtenured, p)
+		&& !isinspace(oldcode, p)
+	) {
+		if (!marklarge(p))
+			VERBOSE(("GC %8ux : <<not in old space>>\n", p));
 		return p;
 	}
 
 	VERBOSE(("GC %8ux : ", p));
 
-	tag = TAG(p);
-	assert(tag != NULL);
-	if (FORWARDED(tag)) {
-		np = FOLLOW(tag);
+	header = HEADER(p);
+	assert(header != NULL);
+	if (FORWARDED(header)) {
+		np = FOLLOW(header);
 		assert(TAG(np)->magic == TAGMAGIC);
 		VERBOSE(("%s	-> %8ux (followed)\n", TAG(np)->typename, np));
 	} else {
+		tag = TAG(p);
 		assert(tag->magic == TAGMAGIC);
-		np = (*tag->copy)(p);
+		np = isinspace(oldcode, p) ? copycode(tag, p) : (*tag->copy)(p);
 		VERBOSE(("%s	-> %8ux (forwarded)\n", tag->typename, np));
-		TAG(p) = FOLLOWTO(np);
+		HEADER(p) = FOLLOWTO(np);
 	}
 
 	if (pmode) {
@@ -322,6 +379,44 @@ extern void *forward(void *p) {
 	return np;
 }
 
+/*
+ * forwardahead -- copy an object now, rather than when the scan reaches it
+ *	copy routines call this on what is almost always read along with
+ *	the object being copied (a list's term, a term's string), so that
+ *	it lands right next to it in new space.  the pointer itself is
+ *	still forwarded when the copy is scanned.
+ */
+extern void forwardahead(void *p) {
+	Tag *tag;
+	void *np;
+
+	if (
+		p == NULL || pmode || (!isinspace(old, p) && !isinspace(oldtenured, p))
+		|| FORWARDED(HEADER(p))
+	)
+		return;
+	tag = TAG(p);
+	assert(tag->magic == TAGMAGIC);
+	np = (*tag->copy)(p);
+	VERBOSE(("GC %8ux : %s	-> %8ux (ahead)\n", p, tag->typename, np));
+	HEADER(p) = FOLLOWTO(np);
+}
+
+/* growrootstack -- make room for more locals on the root stack */
+extern void growrootstack(void) {
+	rootmax = (rootmax == 0) ? 512 : rootmax * 2;
+	rootstack = erealloc(rootstack, rootmax * sizeof (void **));
+}
+
+/* scanrootstack -- scan the locals on the root stack */
+static void scanrootstack(void) {
+	int i;
+	for (i = 0; i < rootsp; i++) {
+		VERBOSE(("GC root at %8lx: %8lx\n", rootstack[i], *rootstack[i]));
+		*rootstack[i] = forward(*rootstack[i]);
+	}
+}
+
 /* scanroots -- scan a rootlist */
 static void scanroots(Root *rootlist) {
 	Root *root;
@@ -331,34 +426,539 @@ static void scanroots(Root *rootlist) {
 	}
 }
 
-/* scanspace -- scan new space until it is up to date */
-static void scanspace(void) {
-	Space *sp, *scanned;
-	for (scanned = NULL;;) {
-		Space *front = new;
-		for (sp = new; sp != scanned; sp = sp->next) {
-			char *scan;
-			assert(sp != NULL);
-			scan = sp->bot;
-			while (scan < sp->current) {
-				Tag *tag = *(Tag **) scan;
-				assert(tag->magic == TAGMAGIC);
-				scan += sizeof (Tag *);
-				VERBOSE(("GC %8ux : %s	scan\n", scan, tag->typename));
-				scan += ALIGN((*tag->scan)(scan));
-			}
+/*
+ * scanspace -- scan a to-space until it is up to date, starting at mark in base
+ *	spaces are pushed on the front of *spacep as they fill, so the scan
+ *	works from base towards the front, finishing each space in
+ *	allocation order; objects copied while scanning an older space
+ *	land in a newer one, which is still to be scanned.
+ */
+static void scanspace(Space **spacep, Space *base, char *mark) {
+	Space *sp, *front;
+	char *scan;
+	for (sp = base, scan = mark;; sp = front, scan = sp->bot) {
+		while (scan < sp->current) {
+			Tag *tag;
+			scan += sizeof (Tag *);
+			tag = TAG(scan);
+			assert(tag->magic == TAGMAGIC);
+			VERBOSE(("GC %8ux : %s	scan\n", scan, tag->typename));
+			scan += ALIGN((*tag->scan)(scan));
 		}
-		if (new == front)
+		if (sp == *spacep)
 			break;
-		scanned = front;
+		for (front = *spacep; front->next != sp; front = front->next)
+			assert(front->next != NULL);
+	}
+}
+
+
+/* spaceused -- number of bytes allocated in a chain of spaces */
+static size_t spaceused(Space *space) {
+	size_t used = 0;
+	for (; space != NULL; space = space->next)
+		used += SPACEUSED(space);
+	return used;
+}
+
+/* spacesize -- number of bytes reserved for a chain of spaces */
+static size_t spacesize(Space *space) {
+	size_t size = 0;
+	for (; space != NULL; space = space->next)
+		size += SPACESIZE(space);
+	return size;
+}
+
+/*
+ * growspace -- add a space to the front of a full chain which can't be collected
+ *	each new space is as big as the whole chain so far, so that the
+ *	chain stays short however much is allocated while collections are
+ *	blocked; isinspace() and thus forward() walk it for every pointer.
+ */
+static Space *growspace(Space *space) {
+	size_t size = spacesize(space);
+	if (size < minspace)
+		size = minspace;
+#if GCPROTECT
+	return mkspace(NULL, space, size);
+#else
+	return newspacesz(space, size);
+#endif
+}
+
+/* gcclock -- a timestamp in microseconds, for measuring pauses */
+static unsigned long gcclock(void) {
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_MONOTONIC)
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return ts.tv_sec * 1000000UL + ts.tv_nsec / 1000;
+#else
+	return clock() / (CLOCKS_PER_SEC / 1000000.0);
+#endif
+}
+
+#if GCPROTECT
+/* basespace -- find the debugging space at the end of a chain */
+static Space *basespace(Space *space) {
+	for (; space->next != NULL; space = space->next)
+		;
+	assert(&spaces[0] <= space && space < &spaces[NSPACES]);
+	return space;
+}
+
+/* ringspace -- set up the next debugging space after base, avoiding tenured space */
+static Space *ringspace(Space *base, size_t size) {
+	Space *space = base, *avoid = basespace(tenured);
+	do
+		if (++space >= &spaces[NSPACES])
+			space = &spaces[FIRSTSPACE];
+	while (space == avoid);
+	return mkspace(space, NULL, size);
+}
+
+/* detachspace -- take a chain off the ring of debugging spaces, leaving its slot empty */
+static Space *detachspace(Space *chain) {
+	Space *base = basespace(chain), *copy, **spp;
+	copy = ealloc(sizeof (Space));
+	*copy = *base;
+	for (spp = &chain; *spp != base; spp = &(*spp)->next)
+		;
+	*spp = copy;
+	base->bot = base->current = base->top = NULL;
+	return chain;
+}
+#endif
+
+
+/*
+ * pointer sets
+ *	open-addressed hash tables of object addresses.
+ */
+
+#define	PTRHASH(p)	((((size_t) (p)) >> 3) * 2654435761u)
+
+/* ptrput -- add a pointer to a set which has room for it */
+static void ptrput(PtrSet *set, void *p) {
+	size_t i, mask = set->size - 1;
+	for (i = PTRHASH(p) & mask; set->table[i] != NULL; i = (i + 1) & mask)
+		if (set->table[i] == p)
+			return;
+	set->table[i] = p;
+	++set->count;
+}
+
+/* ptradd -- add a pointer to a set, growing it if need be */
+static void ptradd(PtrSet *set, void *p) {
+	if ((set->count + 1) * 2 > set->size) {
+		size_t i, oldsize = set->size;
+		void **oldtable = set->table;
+		set->size = (oldsize == 0) ? 64 : oldsize * 2;
+		set->table = ealloc(set->size * sizeof (void *));
+		memzero(set->table, set->size * sizeof (void *));
+		set->count = 0;
+		for (i = 0; i < oldsize; i++)
+			if (oldtable[i] != NULL)
+				ptrput(set, oldtable[i]);
+		if (oldtable != NULL)
+			efree(oldtable);
+	}
+	ptrput(set, p);
+}
+
+/* ptrmember -- is a pointer in a set? */
+static Boolean ptrmember(PtrSet *set, void *p) {
+	size_t i, mask = set->size - 1;
+	if (set->count == 0)
+		return FALSE;
+	for (i = PTRHASH(p) & mask; set->table[i] != NULL; i = (i + 1) & mask)
+		if (set->table[i] == p)
+			return TRUE;
+	return FALSE;
+}
+
+/* ptrclear -- empty a set */
+static void ptrclear(PtrSet *set) {
+	if (set->count > 0) {
+		memzero(set->table, set->size * sizeof (void *));
+		set->count = 0;
+	}
+}
+
+
+/*
+ * the remembered set
+ *	tenured objects which may point into the nursery.  a minor
+ *	collection only copies the nursery, so any store of a pointer
+ *	into an object which could already have been promoted has to be
+ *	reported through gcremember(); those objects are scanned as roots.
+ */
+
+static PtrSet remembered;
+static PtrSet dirty;			/* frozen objects which have been written */
+
+/* gcremember -- write barrier: note that a pointer was stored into p */
+extern void gcremember(void *p) {
+	if (isinspace(nursery, p))
+		return;
+	if (isinspace(tenured, p))
+		ptradd(&remembered, p);
+	else if (frozen != NULL && isinspace(frozen, p))
+		ptradd(&dirty, p);
+}
+
+/* scanremembered -- scan a set of remembered objects as roots */
+static void scanremembered(PtrSet *set) {
+	size_t i;
+	for (i = 0; i < set->size; i++) {
+		void *p = set->table[i];
+		if (p != NULL) {
+			Tag *tag = TAG(p);
+			assert(tag->magic == TAGMAGIC);
+			VERBOSE(("GC remembered %8ux : %s	scan\n", p, tag->typename));
+			(*tag->scan)(p);
+		}
 	}
 }
 
+/* forgetremembered -- empty the remembered set once the nursery is empty */
+static void forgetremembered(void) {
+	ptrclear(&remembered);
+}
+
+
+/*
+ * the large object space
+ *	strings of LARGESIZE bytes or more are allocated on their own and
+ *	never move:  a collection marks the ones it reaches rather than
+ *	copying them, and frees the rest.  large objects allocated since
+ *	the last collection are young; like the nursery, they are the only
+ *	ones a minor collection can free.
+ */
+
+#define	LARGESIZE	4096
+
+typedef struct Large Large;
+struct Large {
+	Large *next;
+	size_t size;
+	Boolean young, marked;
+	Tag *header;			/* must be last:  it is HEADER() of the object */
+};
+
+#define	LARGEOBJ(lp)	((void *) &(lp)[1])
+#define	OBJLARGE(p)	(((Large *) (p)) - 1)
+
+static Large *large = NULL;
+static PtrSet largeset;			/* the objects in large, for forward() */
+static size_t largeyoung = 0, largeold = 0;
+static size_t largelimit = DEFgcminspace;	/* old large bytes which provoke a major collection */
+
+static void collect(Boolean major);
+
+/* largealloc -- allocate an object in the large object space */
+static void *largealloc(size_t nbytes, Tag *header) {
+	Large *lp;
+	if (!gcblocked && largeyoung + nbytes > minspace)
+		collect(FALSE);
+	lp = ealloc(sizeof (Large) + nbytes);
+	lp->next = large;
+	lp->size = nbytes;
+	lp->young = TRUE;
+	lp->marked = FALSE;
+	lp->header = header;
+	large = lp;
+	largeyoung += nbytes;
+	ptradd(&largeset, LARGEOBJ(lp));
+	return LARGEOBJ(lp);
+}
+
+/* marklarge -- note that a collection has reached p, if it is a large object */
+static Boolean marklarge(void *p) {
+	if (!ptrmember(&largeset, p))
+		return FALSE;
+	VERBOSE(("GC %8ux : %s	(large)\n", p, TAG(p)->typename));
+	OBJLARGE(p)->marked = TRUE;
+	return TRUE;
+}
+
+/* sweeplarge -- free the unmarked large objects a collection can reclaim */
+static void sweeplarge(Boolean major) {
+	Large *lp, **lpp;
+	ptrclear(&largeset);
+	largeyoung = largeold = 0;
+	for (lpp = &large; (lp = *lpp) != NULL;)
+		if (!lp->marked && (major || lp->young)) {
+			*lpp = lp->next;
+			efree(lp);
+		} else {
+			lp->young = lp->marked = FALSE;
+			largeold += lp->size;
+			ptradd(&largeset, LARGEOBJ(lp));
+			lpp = &lp->next;
+		}
+}
+
+
+/*
+ * the code space
+ *	pseal() copies parse trees here rather than into the nursery.
+ *	sealed trees only ever point at each other (revtree() relinks
+ *	them, but within one tree), so collections leave the code space
+ *	alone: its objects never move and it is never scanned.  once it
+ *	has grown past codelimit, a major collection compacts it, copying
+ *	the code which is still reachable into a fresh code space, and
+ *	the symbol table and the compiled code of code.c, which refer to
+ *	sealed objects without keeping them alive, are swept.
+ */
+
+#define	MIN_mincode	4096
+
+static Boolean tocode = FALSE;		/* is gcalloc() filling the code space? */
+static size_t codelimit = DEFgcminspace;	/* code bytes which provoke compaction */
+
+/* newcodespace -- add a space of at least size bytes to the front of the code space */
+static Space *newcodespace(Space *next, size_t size) {
+	if (size < MIN_mincode)
+		size = MIN_mincode;
+#if GCPROTECT
+	return mkspace(NULL, next, size);
+#else
+	return newspacesz(next, size);
+#endif
+}
+
+/* releasecode -- free a code space which has been compacted */
+static void releasecode(Space *space) {
+	while (space != NULL) {
+		Space *next = space->next;
+#if GCPROTECT
+		release(space->bot, SPACESIZE(space));
+#endif
+		efree(space);
+		space = next;
+	}
+}
+
+/* codemoved -- where compacting the code space left p, or NULL if it was not copied */
+extern void *codemoved(void *p) {
+	Tag *header;
+	if (!isinspace(oldcode, p))
+		return p;
+	header = HEADER(p);
+	return FORWARDED(header) ? FOLLOW(header) : NULL;
+}
+
+/* issealed -- is p outside the spaces which are collected, so it will keep its address? */
+extern Boolean issealed(void *p) {
+	return !isinspace(nursery, p) && !isinspace(tenured, p) && !isinspace(pspace, p)
+		&& !ptrmember(&largeset, p);
+}
+
+/* copycode -- copy an object from the old code space into the code space */
+static void *copycode(Tag *tag, void *p) {
+	void *np;
+	Space *heap = nursery;
+	nursery = code;
+	tocode = TRUE;
+	np = (*tag->copy)(p);
+	tocode = FALSE;
+	code = nursery;
+	nursery = heap;
+	return np;
+}
+
 
 /*
  * the garbage collector public interface
  */
 
+/* collect -- do a collection: major ones copy tenured space too, minor ones just the nursery */
+static void collect(Boolean major) {
+	size_t nurserydata, tenureddata, codedata, livedata, heapsize;
+	unsigned long start, pause;
+	Space *base, *codebase = NULL;
+	char *mark, *codemark = NULL;
+	Boolean shrunk = FALSE;
+#if GCPROTECT
+	Space *nurserybase;
+#endif
+
+	assert(gcblocked >= 0);
+	if (gcblocked > 0)
+		return;
+	++gcblocked;
+	start = gcclock();
+
+	assert(nursery != NULL);
+	assert(old == NULL);
+	assert(oldtenured == NULL);
+
+	nurserydata = spaceused(nursery);
+	tenureddata = spaceused(tenured);
+	codedata = spaceused(code);
+	if (
+		tenureddata + nurserydata > tenuredlimit
+		|| largeold > largelimit || codedata > codelimit
+		|| (gcmaxheap > 0
+		    && tenureddata + nurserydata + codedata + largeold + largeyoung > gcmaxheap)
+	)
+		major = TRUE;
+
+	old = nursery;
+#if GCPROTECT
+	nurserybase = basespace(nursery);
+#endif
+	if (major) {
+		size_t size = tenureddata + nurserydata;
+		if (size < gcminspace)
+			size = gcminspace;
+		oldtenured = tenured;
+#if GCPROTECT
+		nursery = ringspace(nurserybase, size);
+#else
+		nursery = newspacesz(NULL, size);
+#endif
+	} else
+		nursery = tenured;
+	base = nursery;
+	mark = nursery->current;
+	if (major && (codedata > codelimit || shrinking)) {
+		oldcode = code;
+		code = codebase = newcodespace(NULL, codedata);
+		codemark = code->current;
+	}
+
+	VERBOSE(("\nGC %s collection starting\n", major ? "major" : "minor"));
+#if GCVERBOSE
+	{
+		Space *space;
+		for (space = old; space != NULL; space = space->next)
+			VERBOSE(("GC old space = %ux ... %ux\n", space->bot, space->current));
+		for (space = oldtenured; space != NULL; space = space->next)
+			VERBOSE(("GC old tenured space = %ux ... %ux\n", space->bot, space->current));
+	}
+#endif
+	VERBOSE(("GC new space = %ux ... %ux\n", nursery->bot, nursery->top));
+	VERBOSE(("GC scanning root stack\n"));
+	scanrootstack();
+	VERBOSE(("GC scanning global root list\n"));
+	scanroots(globalrootlist);
+	VERBOSE(("GC scanning exception root list\n"));
+	scanroots(exceptionrootlist);
+	if (!major) {
+		VERBOSE(("GC scanning remembered set\n"));
+		scanremembered(&remembered);
+	}
+	if (dirty.count > 0) {
+		VERBOSE(("GC scanning written frozen objects\n"));
+		scanremembered(&dirty);
+	}
+	VERBOSE(("GC scanning new space\n"));
+	scanspace(&nursery, base, mark);
+	if (oldcode != NULL) {
+		VERBOSE(("GC scanning code space\n"));
+		scanspace(&code, codebase, codemark);
+	}
+	VERBOSE(("GC collection done\n\n"));
+	forgetremembered();
+
+	heapsize = spacesize(old) + spacesize(oldtenured) + spacesize(nursery) + spacesize(pspace)
+		 + spacesize(oldcode) + spacesize(code) + largeyoung + largeold;
+	sweeplarge(major);
+	if (stats.peak < heapsize)
+		stats.peak = heapsize;
+
+	deprecate(old);
+	old = NULL;
+	if (major) {
+		deprecate(oldtenured);
+		oldtenured = NULL;
+	}
+	tenured = nursery;
+	livedata = spaceused(tenured);
+
+#if GCINFO
+	if (gcinfo)
+		eprint(
+			"[%s: old %8d  live %8d  min %8d              (pid %5d)]\n",
+			major ? "major" : "minor",
+			major ? tenureddata + nurserydata : nurserydata,
+			major ? livedata : livedata - tenureddata,
+			minspace, getpid()
+		);
+#endif
+
+	if (major) {
+		if (minspace < livedata * gcgrowth / 2)
+			minspace = livedata * gcgrowth;
+		else if (shrinking || (minspace > livedata * gcshrink && minspace > livedata * gcgrowth)) {
+			minspace = livedata * gcgrowth;
+			shrunk = TRUE;
+		}
+		tenuredlimit = livedata * 2 + minspace;
+		largelimit = largeold * 2 + minspace;
+		heaplive = livedata + largeold + spaceused(code);
+		if (gcmaxheap == 0 || heaplive <= gcmaxheap) {
+			/* a pending complaint is stale once the data is gone */
+			gcoverlimit = FALSE;
+			heapfailed = 0;
+		} else if (heaplive > heapfailed) {
+			/* only complain again if the heap keeps growing */
+			gcoverlimit = TRUE;
+			heapfailed = heaplive;
+		}
+	}
+	if (oldcode != NULL) {
+		sweepsymbols();
+		sweepcode();
+		releasecode(oldcode);
+		oldcode = NULL;
+		codelimit = spaceused(code) * 2 + minspace;
+	}
+	if (gcmaxpause > 0 && stats.pausetotal > 0) {
+		/* at worst everything in the nursery survives and is copied */
+		size_t cap = stats.copied / stats.pausetotal * gcmaxpause;
+		if (minspace > cap)
+			minspace = cap;
+	}
+	if (gcmaxheap > 0 && heaplive + minspace > gcmaxheap)
+		minspace = (heaplive < gcmaxheap) ? gcmaxheap - heaplive : 0;
+	if (minspace < gcminspace)
+		minspace = gcminspace;
+	if (minspace < minneeded)
+		minspace = minneeded;
+
+#if GCPROTECT
+	nursery = ringspace(nurserybase, minspace);
+#else
+	nursery = newspace(NULL);
+#endif
+
+	/* after a peak, give back the memory the smaller heap will not touch */
+	if (shrunk) {
+		trimspace(nursery);
+		trimspace(tenured);
+		trimspace(code);
+#if HAVE_MALLOC_TRIM
+		malloc_trim(0);
+#endif
+	}
+
+	++stats.collections;
+	++gcgeneration;
+	if (major) {
+		++stats.majors;
+		stats.copied += livedata;
+	} else
+		stats.copied += livedata - tenureddata;
+	pause = gcclock() - start;
+	stats.pausetotal += pause;
+	if (stats.pausemax < pause)
+		stats.pausemax = pause;
+
+	--gcblocked;
+}
+
 /* gcenable -- enable collections */
 extern void gcenable(void) {
 	assert(gcblocked > 0);
@@ -366,9 +966,9 @@ extern void gcenable(void) {
 #if GCALWAYS
 	if (!gcblocked)
 #else
-	if (!gcblocked && new->next != NULL)
+	if (!gcblocked && nursery->next != NULL)
 #endif
-		gc();
+		collect(FALSE);
 }
 
 /* gcdisable -- disable collections */
@@ -379,14 +979,16 @@ extern void gcdisable(void) {
 
 /* gcreserve -- provoke a collection if there's not a certain amount of space around */
 extern void gcreserve(size_t minfree) {
-	if (SPACEFREE(new) < (int)minfree) {
+	if (SPACEFREE(nursery) < (int)minfree) {
 		if (minspace < minfree)
 			minspace = minfree;
-		gc();
+		minneeded = minfree;
+		collect(FALSE);
+		minneeded = 0;
 	}
 #if GCALWAYS
 	else
-		gc();
+		collect(FALSE);
 #endif
 }
 
@@ -396,73 +998,40 @@ extern Boolean gcisblocked(void) {
 	return gcblocked != 0;
 }
 
-/* gc -- actually do a garbage collection */
+/* gc -- actually do a full garbage collection */
 extern void gc(void) {
-	do {
-		size_t livedata;
-		Space *space;
-
-#if GCINFO
-		size_t olddata = 0;
-		if (gcinfo)
-			for (space = new; space != NULL; space = space->next)
-				olddata += SPACEUSED(space);
-#endif
-
-		assert(gcblocked >= 0);
-		if (gcblocked > 0)
-			return;
-		++gcblocked;
-
-		assert(new != NULL);
-		assert(old == NULL);
-		old = new;
-#if GCPROTECT
-		for (; new->next != NULL; new = new->next)
-			;
-		if (++new >= &spaces[NSPACES])
-			new = &spaces[FIRSTSPACE];
-		new = mkspace(new, NULL, minspace);
-#else
-		new = newspace(NULL);
-#endif
-		VERBOSE(("\nGC collection starting\n"));
-#if GCVERBOSE
-		for (space = old; space != NULL; space = space->next)
-			VERBOSE(("GC old space = %ux ... %ux\n", space->bot, space->current));
-#endif
-		VERBOSE(("GC new space = %ux ... %ux\n", new->bot, new->top));
-		VERBOSE(("GC scanning root list\n"));
-		scanroots(rootlist);
-		VERBOSE(("GC scanning global root list\n"));
-		scanroots(globalrootlist);
-		VERBOSE(("GC scanning exception root list\n"));
-		scanroots(exceptionrootlist);
-		VERBOSE(("GC scanning new space\n"));
-		scanspace();
-		VERBOSE(("GC collection done\n\n"));
-
-		deprecate(old);
-		old = NULL;
-
-		for (livedata = 0, space = new; space != NULL; space = space->next)
-			livedata += SPACEUSED(space);
+	collect(TRUE);
+}
 
-#if GCINFO
-		if (gcinfo)
-			eprint(
-				"[   GC: old %8d  live %8d  min %8d              (pid %5d)]\n",
-				olddata, livedata, minspace, getpid()
-			);
-#endif
+/* gcshrinkheap -- do a full garbage collection, and shrink the heap to fit what's left */
+extern void gcshrinkheap(void) {
+	shrinking = TRUE;
+	collect(TRUE);
+	shrinking = FALSE;
+}
 
-		if (minspace < livedata * 2)
-			minspace = livedata * 4;
-		else if (minspace > livedata * 12 && minspace > (MIN_minspace * 2))
-			minspace /= 2;
+/*
+ * gcidle -- the shell is waiting for input, so collect now if a collection is close
+ *	a major collection which is half way due is done here rather than
+ *	in the middle of the next command or completion.
+ */
+extern void gcidle(void) {
+	if (
+		spaceused(tenured) + spaceused(nursery) > tenuredlimit / 2
+		|| largeold > largelimit / 2 || spaceused(code) > codelimit / 2
+	)
+		collect(TRUE);
+	else if (SPACEUSED(nursery) > SPACESIZE(nursery) / 2)
+		collect(FALSE);
+}
 
-		--gcblocked;
-	} while (new->next != NULL);
+/* gcheapfail -- report that live data has grown past max-heap-size */
+extern Noreturn gcheapfail(void) {
+	gcoverlimit = FALSE;
+	while (gcisblocked())
+		gcenable();
+	fail("es:heap", "%uld bytes of live data exceeds max-heap-size of %uld",
+	     (unsigned long) heaplive, gcmaxheap);
 }
 
 /* pseal -- collect pspace to new with p as its only root, and return the collected p */
@@ -481,37 +1050,44 @@ extern void *pseal(void *p) {
 
 	if (psize == 0)
 		return p;
-
-	/* TODO: this is an overestimate since it counts garbage */
-	gcreserve(psize);
-	VERBOSE(("Reserved %d for pspace copy\n", psize));
+	++stats.pseals;
+	++gcgeneration;
 
 #if GCINFO
 	if (gcinfo)
-		for (sp = new; sp != NULL; sp = sp->next)
-			newdata += SPACEUSED(sp);
+		newdata = spaceused(code);
 #endif
 
 	assert (gcblocked >= 0);
 	++gcblocked;
 
+	/* the sealed tree is no bigger than pspace, so it fits in one code space */
+	if ((size_t) SPACEFREE(code) < psize)
+		code = newcodespace(code, psize + spacesize(code) / 2);
+	VERBOSE(("Reserved %d for pspace copy\n", psize));
+
 #if GCVERBOSE
 	for (sp = pspace; sp != NULL; sp = sp->next)
 		VERBOSE(("GC pspace = %ux ... %ux\n", sp->bot, sp->current));
 #endif
 	if (p != NULL) {
-		VERBOSE(("GC new space = %ux ... %ux\n", new->bot, new->top));
+		Space *heap = nursery;
+		VERBOSE(("GC code space = %ux ... %ux\n", code->bot, code->top));
 
+		nursery = code;
+		tocode = TRUE;
 		pmode = TRUE;
 		p = forward(p);
 		(*(TAG(p))->scan)(p);
 		pmode = FALSE;
+		tocode = FALSE;
+		code = nursery;
+		nursery = heap;
 	}
 
 #if GCINFO
 	if (gcinfo) {
-		for (sp = new; sp != NULL; sp = sp->next)
-			livedata += SPACEUSED(sp);
+		livedata = spaceused(code);
 		eprint(
 			"[pseal: old %8d  live %8d  min %8d  diff %5d  (pid %5d)]\n",
 			psize, livedata, minpspace, (livedata - newdata), getpid()
@@ -539,19 +1115,166 @@ extern void *pseal(void *p) {
 	return p;
 }
 
+/* gcstats -- report the collector's counters and current space sizes */
+extern void gcstats(GCStats *sp) {
+	*sp = stats;
+	sp->nursery = spacesize(nursery);
+	sp->tenured = spacesize(tenured);
+	sp->pspace = spacesize(pspace);
+	sp->code = spacesize(code);
+	sp->frozen = spacesize(frozen);
+	sp->large = largeyoung + largeold;
+	if (sp->peak < sp->nursery + sp->tenured + sp->pspace + sp->code + sp->large)
+		sp->peak = sp->nursery + sp->tenured + sp->pspace + sp->code + sp->large;
+}
+
+/*
+ * gcfreeze -- stop collecting everything inherited from the parent
+ *	called in a child right after fork(); the spaces it shares with
+ *	its parent become a frozen old generation which is never copied
+ *	or swept, so the child only dirties pages it writes to itself.
+ *	frozen objects the child writes to are remembered in dirty, which
+ *	is scanned as roots by every collection.
+ */
+extern void gcfreeze(void) {
+	Space *sp, **spp;
+#if GCPROTECT
+	Space *nurseryslot = basespace(nursery), *tenuredslot = basespace(tenured);
+	nursery = detachspace(nursery);
+	tenured = detachspace(tenured);
+#endif
+
+	assert(old == NULL && oldtenured == NULL && oldcode == NULL);
+	for (spp = &frozen; *spp != NULL; spp = &(*spp)->next)
+		;
+	for (sp = tenured; sp->next != NULL; sp = sp->next)
+		;
+	*spp = tenured;
+	spp = &sp->next;
+	for (sp = nursery; sp->next != NULL; sp = sp->next)
+		;
+	*spp = nursery;
+	sp->next = code;
+
+	/* objects in the remembered set were frozen along with what they point to */
+	forgetremembered();
+	large = NULL;
+	ptrclear(&largeset);
+	largeyoung = largeold = 0;
+
+#if GCPROTECT
+	nursery = mkspace(nurseryslot, NULL, minspace);
+	tenured = mkspace(tenuredslot, NULL, minspace);
+#else
+	nursery = newspace(NULL);
+	tenured = newspace(NULL);
+#endif
+	code = newcodespace(NULL, 0);
+	VERBOSE(("GC froze %d bytes\n", spaceused(frozen)));
+}
+
+
+/*
+ * heap census
+ *	walks everything reachable from the roots without moving it.
+ *	each object's scan routine is used to find what it points to:
+ *	while a census is running, forward() just hands every pointer
+ *	to censusvisit(), which queues the objects it hasn't seen yet.
+ */
+
+static PtrSet censusseen;
+static void **censusstack = NULL;
+static size_t censusdepth = 0, censusmax = 0;
+
+/* censusvisit -- note that the census has reached p */
+static void censusvisit(void *p) {
+	if (
+		p == NULL || ptrmember(&censusseen, p)
+		|| (
+			!isinspace(nursery, p) && !isinspace(tenured, p)
+			&& !isinspace(code, p) && !isinspace(pspace, p)
+			&& !isinspace(frozen, p) && !ptrmember(&largeset, p)
+		)
+	)
+		return;
+	ptradd(&censusseen, p);
+	if (censusdepth == censusmax) {
+		censusmax = (censusmax == 0) ? 1024 : censusmax * 2;
+		censusstack = erealloc(censusstack, censusmax * sizeof (void *));
+	}
+	censusstack[censusdepth++] = p;
+}
+
+/* censuswalk -- scan everything reachable from the queued objects, tallying it by type */
+static size_t censuswalk(GCCensus *census, int max, int *np) {
+	size_t total = 0;
+	++gcblocked;
+	incensus = TRUE;
+	while (censusdepth > 0) {
+		void *p = censusstack[--censusdepth];
+		Tag *tag = TAG(p);
+		size_t size;
+		assert(tag->magic == TAGMAGIC);
+		size = sizeof (Tag *) + ALIGN((*tag->scan)(p));
+		total += size;
+		if (census != NULL) {
+			int i;
+			for (i = 0; i < *np && census[i].name != tag->typename; i++)
+				;
+			if (i == *np) {
+				if (i == max)
+					continue;
+				census[i].name = tag->typename;
+				census[i].count = 0;
+				census[i].bytes = 0;
+				++*np;
+			}
+			++census[i].count;
+			census[i].bytes += size;
+		}
+	}
+	incensus = FALSE;
+	ptrclear(&censusseen);
+	--gcblocked;
+	return total;
+}
+
+/* gccensus -- tally the objects reachable from the roots by type; returns the number of types */
+extern int gccensus(GCCensus *census, int max) {
+	int i, n = 0;
+	Root *root;
+	for (i = 0; i < rootsp; i++)
+		censusvisit(*rootstack[i]);
+	for (root = globalrootlist; root != NULL; root = root->next)
+		censusvisit(*root->p);
+	for (root = exceptionrootlist; root != NULL; root = root->next)
+		censusvisit(*root->p);
+	censuswalk(census, max, &n);
+	return n;
+}
+
+/* gcreachable -- the number of bytes in objects reachable from p */
+extern size_t gcreachable(void *p) {
+	censusvisit(p);
+	return censuswalk(NULL, 0, NULL);
+}
+
 /* initgc -- initialize the garbage collector */
 extern void initgc(void) {
-#if GCPROTECT
 	initmmu();
+#if GCPROTECT
 	spaces = ealloc(NSPACES * sizeof (Space));
 	memzero(spaces, NSPACES * sizeof (Space));
-	new = mkspace(&spaces[FIRSTSPACE], NULL, minspace);
+	nursery = mkspace(&spaces[FIRSTSPACE], NULL, minspace);
+	tenured = mkspace(&spaces[FIRSTSPACE + 1], NULL, minspace);
 	pspace = mkspace(&spaces[0], NULL, minpspace);
 #else
-	new = newspace(NULL);
+	nursery = newspace(NULL);
+	tenured = newspace(NULL);
 	pspace = newpspace(NULL);
 #endif
-	old = NULL;
+	code = newcodespace(NULL, 0);
+	old = oldtenured = oldcode = NULL;
 }
 
 
@@ -563,23 +1286,31 @@ extern void initgc(void) {
 extern void *gcalloc(size_t nbytes, Tag *tag) {
 	size_t n = ALIGN(nbytes + sizeof (Tag *));
 #if GCALWAYS
-	gc();
+	collect(FALSE);
 #endif
 	assert(tag == NULL || tag->magic == TAGMAGIC);
+	if (tag == &StringTag) {
+		if (nbytes >= LARGESIZE && !tocode)
+			return largealloc(nbytes, STRHEADER(nbytes));
+		tag = STRHEADER(nbytes);
+	}
 	for (;;) {
-		Tag **p = (void *) new->current;
+		Tag **p = (void *) nursery->current;
 		char *q = ((char *) p) + n;
-		if (q <= new->top) {
-			new->current = q;
+		if (q <= nursery->top) {
+			nursery->current = q;
 			*p++ = tag;
 			return p;
 		}
 		if (minspace < nbytes)
 			minspace = nbytes + sizeof (Tag *);
 		if (gcblocked)
-			new = newspace(new);
-		else
-			gc();
+			nursery = growspace(nursery);
+		else {
+			minneeded = n;
+			collect(FALSE);
+			minneeded = 0;
+		}
 	}
 }
 
@@ -587,6 +1318,8 @@ extern void *gcalloc(size_t nbytes, Tag *tag) {
 extern void *palloc(size_t nbytes, Tag *tag) {
 	size_t n = ALIGN(nbytes + sizeof (Tag *));
 	assert(tag == NULL || tag->magic == TAGMAGIC);
+	if (tag == &StringTag)
+		tag = STRHEADER(nbytes);
 	for (;;) {
 		Tag **p = (void *) pspace->current;
 		char *q = ((char *) p) + n;
@@ -602,6 +1335,96 @@ extern void *palloc(size_t nbytes, Tag *tag) {
 }
 
 
+/*
+ * symbols
+ *	pseal() interns the short strings of a parse tree as it copies
+ *	them into the code space, so every occurrence of a name in sealed
+ *	code is the same string and lookups can usually compare pointers.
+ *	the table is weak: it never keeps a string alive, and compacting
+ *	the code space drops the symbols which were not copied.
+ */
+
+#define	SYMBOLMAX	64		/* longest string (with its '\0') worth interning */
+
+typedef struct {
+	char *name;
+	unsigned long hash;
+} Symbol;
+
+static Symbol *symbols = NULL;
+static int symbolsize = 0, symbolcount = 0;
+
+/* addsymbol -- insert a symbol known not to be present into a table with room for it */
+static void addsymbol(Symbol *table, int size, char *name, unsigned long hash) {
+	int i;
+	for (i = hash & (size - 1); table[i].name != NULL; i = (i + 1) & (size - 1))
+		;
+	table[i].name = name;
+	table[i].hash = hash;
+}
+
+/* resizesymbols -- rebuild the symbol table, keeping the symbols keep() returns a name for */
+static void resizesymbols(int size, char *(*keep)(char *)) {
+	int i;
+	Symbol *old = symbols;
+	int oldsize = symbolsize;
+
+	symbols = ealloc(size * sizeof (Symbol));
+	memzero(symbols, size * sizeof (Symbol));
+	symbolsize = size;
+	symbolcount = 0;
+	for (i = 0; i < oldsize; i++) {
+		char *name = old[i].name;
+		if (name != NULL && (name = (*keep)(name)) != NULL) {
+			addsymbol(symbols, size, name, old[i].hash);
+			++symbolcount;
+		}
+	}
+	if (old != NULL)
+		efree(old);
+}
+
+static char *keepsymbol(char *name) {
+	return name;
+}
+
+/* getsymbol -- find the interned copy of a string, if there is one */
+static char *getsymbol(const char *name, unsigned long hash) {
+	int i;
+	if (symbols == NULL)
+		return NULL;
+	for (i = hash & (symbolsize - 1); symbols[i].name != NULL; i = (i + 1) & (symbolsize - 1))
+		if (symbols[i].hash == hash && streq(symbols[i].name, name))
+			return symbols[i].name;
+	return NULL;
+}
+
+/* putsymbol -- intern a string in the code space */
+static void putsymbol(char *name, unsigned long hash) {
+	if ((symbolcount + 1) * 2 > symbolsize)
+		resizesymbols(symbolsize == 0 ? 256 : symbolsize * 2, keepsymbol);
+	addsymbol(symbols, symbolsize, name, hash);
+	++symbolcount;
+}
+
+/* sweepsymbol -- follow a symbol the compaction copied, drop one it did not */
+static char *sweepsymbol(char *name) {
+	return codemoved(name);
+}
+
+/* sweepsymbols -- fix up the symbol table after the code space is compacted */
+static void sweepsymbols(void) {
+	if (symbols != NULL)
+		resizesymbols(symbolsize, sweepsymbol);
+}
+
+/* intern -- return the interned copy of a string, or the string itself */
+extern char *intern(char *name) {
+	char *sym = getsymbol(name, strhash(name));
+	return sym == NULL ? name : sym;
+}
+
+
 /*
  * strings
  */
@@ -611,25 +1434,37 @@ DefineTag(String, notstatic);
 
 extern char *gcndup(const char *s, size_t n) {
 	char *ns;
+	const char *nul;
 
-	gcdisable();
+	/* keep the header exact for gcstrlen() */
+	if ((nul = memchr(s, '\0', n)) != NULL)
+		n = nul - s;
+
+	/* s may point into gc space, so nothing can move until it is copied */
+	++gcblocked;
 	ns = gcalloc((n + 1) * sizeof (char), &StringTag);
+	--gcblocked;
 	memcpy(ns, s, n);
 	ns[n] = '\0';
-	assert(strlen(ns) == n);
 
-	Ref(char *, result, ns);
-	gcenable();
-	RefReturn(result);
+	if (!gcblocked && nursery->next != NULL) {
+		Ref(char *, result, ns);
+		collect(FALSE);
+		RefReturn(result);
+	}
+	return ns;
 }
 
 extern char *pndup(const char *s, size_t n) {
 	char *ns;
+	const char *nul;
+
+	if ((nul = memchr(s, '\0', n)) != NULL)
+		n = nul - s;
 
 	ns = palloc((n + 1) * sizeof (char), &StringTag);
 	memcpy(ns, s, n);
 	ns[n] = '\0';
-	assert(strlen(ns) == n);
 
 	return ns;
 }
@@ -642,15 +1477,64 @@ extern char *pdup(const char *s) {
 	return pndup(s, strlen(s));
 }
 
+/*
+ * gcstrlen -- the length of a string, read from its header if it has one
+ *	every string the allocator makes holds exactly its characters and
+ *	the terminator, so a string in a collected space need not be
+ *	measured.  a pointer into the middle of a string finds characters
+ *	where the header should be, which the bounds and terminator checks
+ *	reject; anything else falls back to strlen().
+ */
+extern size_t gcstrlen(const char *s) {
+	static Space **spacelists[] = { &nursery, &tenured, &code, &pspace, &frozen };
+	const char *limit = NULL;
+	Tag *tag;
+	size_t n;
+	int i;
+
+	for (i = 0; i < arraysize(spacelists) && limit == NULL; i++) {
+		Space *sp;
+		for (sp = *spacelists[i]; sp != NULL; sp = sp->next)
+			if (sp->bot + sizeof (Tag *) <= s && s < sp->current) {
+				limit = sp->current;
+				break;
+			}
+	}
+	if (limit == NULL) {
+		if (!ptrmember(&largeset, (void *) s))
+			return strlen(s);
+		limit = s + STRLENGTH(HEADER(s));
+	}
+
+	tag = HEADER(s);
+	if (ISSTRHEADER(tag) && !FORWARDED(tag)) {
+		n = STRLENGTH(tag);
+		if (n > 0 && n <= (size_t) (limit - s) && s[n - 1] == '\0')
+			return n - 1;
+	}
+	return strlen(s);
+}
+
 static void *StringCopy(void *op) {
-	size_t n = strlen(op) + 1;
-	char *np = gcalloc(n, &StringTag);
+	size_t n = STRLENGTH(HEADER(op));
+	char *np;
+	unsigned long hash = 0;
+	Boolean symbolic = pmode && n <= SYMBOLMAX && strlen(op) + 1 == n;
+
+	if (symbolic) {
+		hash = strhash(op);
+		if ((np = getsymbol(op, hash)) != NULL)
+			return np;
+	}
+	np = gcalloc(n, &StringTag);
 	memcpy(np, op, n);
+	if (symbolic)
+		putsymbol(np, hash);
 	return np;
 }
 
 static size_t StringScan(void *p) {
-	return strlen(p) + 1;
+	return STRLENGTH(HEADER(p));
 }
 
 
@@ -755,20 +1639,13 @@ static char *tree2name(NodeKind k) {
 	}
 }
 
-/* having these here violates every data hiding rule in the book */
-
-	typedef struct {
-		char *name;
-		void *value;
-	} Assoc;
-	struct Dict {
-		int size, remain;
-		Assoc table[1];		/* variable length */
-	};
-
 #include "var.h"
 #include "term.h"
 
+/* dumpassoc -- dictforall procedure to print one entry of a Dict */
+static void dumpassoc(void UNUSED *arg, char *name, void *value) {
+	print("\tname = %ux  value = %ux\n", name, value);
+}
 
 static size_t dump(Tag *t, void *p) {
 	char *s = t->typename;
@@ -776,7 +1653,7 @@ static size_t dump(Tag *t, void *p) {
 
 	if (streq(s, "String")) {
 		print("%s\n", p);
-		return strlen(p) + 1;
+		return STRLENGTH(HEADER(p));
 	}
 
 	if (streq(s, "Term")) {
@@ -839,29 +1716,34 @@ static size_t dump(Tag *t, void *p) {
 	}
 
 	if (streq(s, "Dict")) {
-		Dict *d = p;
-		int i;
-		print("size = %d  remain = %d\n", d->size, d->remain);
-		for (i = 0; i < d->size; i++)
-			print("\tname = %ux  value = %ux\n",
-			      d->table[i].name, d->table[i].value);
-		return offsetof(Dict, table[d->size]);
+		print("bytes = %d\n", dictsize(p));
+		dictforall(p, dumpassoc, NULL);
+		return dictsize(p);
 	}
 
 	print("<<unknown>>\n");
 	return 0;
 }
 
-extern void memdump(void) {
-	Space *sp;
-	for (sp = new; sp != NULL; sp = sp->next) {
+static void dumpspace(Space *sp) {
+	for (; sp != NULL; sp = sp->next) {
 		char *scan = sp->bot;
 		while (scan < sp->current) {
-			Tag *tag = *(Tag **) scan;
-			assert(tag->magic == TAGMAGIC);
+			Tag *tag;
 			scan += sizeof (Tag *);
+			tag = TAG(scan);
+			assert(tag->magic == TAGMAGIC);
 			scan += ALIGN(dump(tag, scan));
 		}
 	}
 }
+
+extern void memdump(void) {
+	print("tenured space:\n");
+	dumpspace(tenured);
+	print("nursery:\n");
+	dumpspace(nursery);
+	print("code space:\n");
+	dumpspace(code);
+}
 #endif
@@ -9,9 +9,9 @@
 struct Tag {
 	void *(*copy)(void *);
 	size_t (*scan)(void *);
+	char *typename;			/* for debugging and $&heapcensus */
 #if ASSERTIONS || GCVERBOSE
 	long magic;
-	char *typename;
 #endif
 };
 
@@ -22,20 +22,59 @@ enum {TAGMAGIC = 0xDefaced};
 #define	DefineTag(t, storage) \
 	static void *CONCAT(t,Copy)(void *); \
 	static size_t CONCAT(t,Scan)(void *); \
-	storage Tag CONCAT(t,Tag) = { CONCAT(t,Copy), CONCAT(t,Scan), TAGMAGIC, STRING(t) }
+	storage Tag CONCAT(t,Tag) = { CONCAT(t,Copy), CONCAT(t,Scan), STRING(t), TAGMAGIC }
 #else
 #define	DefineTag(t, storage) \
 	static void *CONCAT(t,Copy)(void *); \
 	static size_t CONCAT(t,Scan)(void *); \
-	storage Tag CONCAT(t,Tag) = { CONCAT(t,Copy), CONCAT(t,Scan) }
+	storage Tag CONCAT(t,Tag) = { CONCAT(t,Copy), CONCAT(t,Scan), STRING(t) }
 #endif
 
 /*
  * allocation
+ *	gcnew() bumps the nursery's allocation pointer in line, and only
+ *	calls gcalloc(), which may collect, when the nursery is full.
+ *	a constructor which has to keep its arguments alive can instead
+ *	gcreserve() room for all of its objects, rooting the arguments only
+ *	if GCNEEDRESERVE() says a collection may happen, and then allocate
+ *	them with gcnewreserved(), which does not collect even in GCALWAYS
+ *	builds.  in those builds GCNEEDRESERVE() is always true, so every
+ *	constructor still collects and exposes unrooted temporaries.
  */
 
+typedef struct Space Space;
+struct Space {
+	char *current, *bot, *top;
+	Space *next;
+};
+
+extern Space *nursery;
+
 extern void *gcalloc(size_t, Tag *);
 
+#define	GCALIGN(n)	(((n) + sizeof (void *) - 1) &~ (sizeof (void *) - 1))
+#define	GCSIZE(type)	GCALIGN(sizeof (Tag *) + sizeof (type))
+#define	GCROOM(n)	((size_t) (nursery->top - nursery->current) >= (n))
+#define	GCBUMP(n, tag) \
+	(*(Tag **) nursery->current = (tag), \
+	 (void *) ((nursery->current += (n)) - (n) + sizeof (Tag *)))
+
+#if GCALWAYS
+#define	GCNEEDRESERVE(n)	TRUE
+#else
+#define	GCNEEDRESERVE(n)	(!GCROOM(n))
+#endif
+
+#define	gcnewreserved(type) \
+	((type *) (GCROOM(GCSIZE(type)) \
+		   ? GCBUMP(GCSIZE(type), &(CONCAT(type,Tag))) \
+		   : gcalloc(sizeof (type), &(CONCAT(type,Tag)))))
+#if GCALWAYS
+#define	gcnew(type)	((type *) gcalloc(sizeof (type), &(CONCAT(type,Tag))))
+#else
+#define	gcnew(type)	gcnewreserved(type)
+#endif
+
 typedef struct Buffer Buffer;
 struct Buffer {
 	size_t len;
@@ -55,3 +94,7 @@ extern char *psealcountedbuffer(Buffer *buf);	/* pspace variant of sealcountedbu
 extern void freebuffer(Buffer *buf);
 
 extern void *forward(void *p);
+extern void forwardahead(void *p);
+
+extern void *codemoved(void *p);	/* where compacting the code space left p, or NULL */
+extern Boolean issealed(void *p);	/* is p outside the spaces which are collected? */
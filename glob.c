@@ -185,6 +185,7 @@ static List *glob0(List *list, StrList *quote) {
 		) {
 			*prevp = list;
 			prevp = &list->next;
+			gcremember(list);
 		} else {
 			*prevp = sortlist(expand1);
 			while (*prevp != NULL)
@@ -226,6 +227,7 @@ static char *expandhome(char *s, StrList *qp) {
 		if (c == '\0') {
 			string = home;
 			quote->str = QUOTED;
+			gcremember(quote);
 		} else {
 			char *q;
 			size_t pathlen = strlen(string);
@@ -251,6 +253,7 @@ static char *expandhome(char *s, StrList *qp) {
 				q[len] = '\0';
 			}
 			quote->str = q;
+			gcremember(quote);
 		}
 		RefEnd(home);
 	}
@@ -279,6 +282,7 @@ extern List *glob(List *list, StrList *quote) {
 				str = expandhome(str, qp);
 				tmp = mkstr(str);
 				lr->term = tmp;
+				gcremember(lr);
 				lp = lr;
 				qp = qr;
 				list = l0;
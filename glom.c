@@ -41,8 +41,8 @@ static char *qcat(const char *quote1, const char *quote2, Term *term1, Term *ter
     if (quote1 == UNQUOTED && quote2 == UNQUOTED)
         return UNQUOTED;
 
-    length1 = (quote1 == QUOTED || quote1 == UNQUOTED) ? strlen(getstr(term1)) : strlen(quote1);
-    length2 = (quote2 == QUOTED || quote2 == UNQUOTED) ? strlen(getstr(term2)) : strlen(quote2);
+    length1 = (quote1 == QUOTED || quote1 == UNQUOTED) ? gcstrlen(getstr(term1)) : gcstrlen(quote1);
+    length2 = (quote2 == QUOTED || quote2 == UNQUOTED) ? gcstrlen(getstr(term2)) : gcstrlen(quote2);
     result  = string_ptr = gcalloc(length1 + length2 + 1, &StringTag);
 
     if (quote1 == QUOTED)
@@ -72,7 +72,7 @@ static char *qcat(const char *quote1, const char *quote2, Term *term1, Term *ter
 }
 
 /* qconcat -- cartesian cross product concatenation; also produces a quote list */
-static List *qconcat(List *first_list, List *second_list, StrList *quote_list1, StrList *quote_list2, StrList **quote_result)
+extern List *qconcat(List *first_list, List *second_list, StrList *quote_list1, StrList *quote_list2, StrList **quote_result)
 {   List    **list_ptr;
     List     *result    = NULL;
     StrList **quote_ptr;
@@ -104,7 +104,7 @@ static List *qconcat(List *first_list, List *second_list, StrList *quote_list1,
 /* subscript -- variable subscripting with range support
  * Supports syntax like: $var(1), $var(2...5), $var(1...)
  */
-static List *subscript(List *list, List *subscript_list)
+extern List *subscript(List *list, List *subscript_list)
 {   int    low_index;
     int    high_index;
     int    list_length;
@@ -233,7 +233,9 @@ static List *glom1(Tree *tree, Binding *binding)
                         tail = result = list;
 					
                     else
-                        tail->next = list;
+                    {   tail->next = list;
+                        gcremember(tail);
+                    }
 				 
                     for (; tail->next != NULL; tail = tail->next)
                         ;
@@ -290,7 +292,9 @@ static List *glom1(Tree *tree, Binding *binding)
                 tail = result = list;
 			
             else
-                tail->next = list;
+            {   tail->next = list;
+                gcremember(tail);
+            }
 		 
             for (; tail->next != NULL; tail = tail->next)
                 ;
@@ -373,6 +377,8 @@ extern List *glom2(Tree *tree, Binding *binding, StrList **quote_result)
             {   assert(*quote_result != NULL);
                 tail->next       = list;
                 quote_tail->next = quote_list;
+                gcremember(tail);
+                gcremember(quote_tail);
             }
             
             for (; tail->next != NULL; tail = tail->next, quote_tail = quote_tail->next)
@@ -388,10 +394,15 @@ extern List *glom2(Tree *tree, Binding *binding, StrList **quote_result)
 }
 
 /* glom -- top level glom dispatching
- * If globit is true, performs globbing on the result
+ * If globit is true, performs globbing on the result; sealed trees run as compiled code
  */
 extern List *glom(Tree *tree, Binding *binding, Boolean globit)
-{   if (globit)
+{   Code *code = getcode(tree, globit ? codeGlob : codeList);
+
+    if (code != NULL)
+        return runcode(code, binding, 0);
+
+    if (globit)
     {   Ref(List    *, list,  NULL);
         Ref(StrList *, quote, NULL);
         
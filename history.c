@@ -55,12 +55,12 @@ extern char *dumphistbuffer(void) {
         size_t len;
 	assert(histbuffer != NULL);
 
+	/* trim before sealing, so the string's gc header stays exact */
+	len = histbuffer->current;
+	if (len > 0 && histbuffer->str[len - 1] == '\n')
+		histbuffer->current = len - 1;
 	s = sealcountedbuffer(histbuffer);
 	histbuffer = NULL;
-
-	len = strlen(s);
-	if (len > 0 && s[len - 1] == '\n')
-		s[len - 1] = '\0';
 	return s;
 }
 
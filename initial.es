@@ -77,6 +77,7 @@ fn-result      = $&result
 fn-throw       = $&throw
 fn-umask       = $&umask
 fn-wait        = $&wait
+fn-while       = $&while
 fn-%read       = $&read
 
 #    eval runs its arguments by turning them into a code fragment
@@ -172,28 +173,6 @@ fn whatis {
     }
 }
 
-#    The while function is implemented with the forever looping primitive.
-#    While uses $&noreturn to indicate that, while it is a lambda, it
-#    does not catch the return exception.  It does, however, catch break.
-
-fn-while = $&noreturn @ cond body {
-    catch @ e value {
-        if {!~ $e break} {
-            throw $e $value
-        }
-        result $value
-    } {
-        let (result = <=true)
-            forever {
-                if {!$cond} {
-                    throw break $result
-                } {
-                    result = <=$body
-                }
-            }
-    }
-}
-
 #    The cd builtin provides a friendlier veneer over the cd primitive:
 #    it knows about no arguments meaning ``cd $home'' and has friendlier
 #    error messages than the raw $&cd.  (It also used to search $cdpath,
@@ -357,46 +336,13 @@ fn %backquote {
 #        cmd1 || cmd2    %or  {cmd1} {cmd2}
 #
 #    Note that %seq is also used for newline-separated commands within
-#    braces.  The logical operators are implemented in terms of if.
-#
-#    %and and %or are recursive, which is slightly inefficient given
-#    the current implementation of es -- it is not properly tail recursive
-#    -- but that can be fixed and it's still better to write more of
-#    the shell in es itself.
+#    braces.  The logical operators are primitives, so that a break or
+#    return inside them reaches the enclosing loop or function directly.
 
 fn-%seq        = $&seq
-
-fn-%not = $&noreturn @ cmd {
-    if {$cmd} {false} {true}
-}
-
-fn-%and = $&noreturn @ first rest {
-    let (result = <={$first}) {
-        if {~ $#rest 0} {
-            result $result
-        } {result $result} {
-            %and $rest
-        } {
-            result $result
-        }
-    }
-}
-
-fn-%or = $&noreturn @ first rest {
-    if {~ $#first 0} {
-        false
-    } {
-        let (result = <={$first}) {
-            if {~ $#rest 0} {
-                result $result
-            } {!result $result} {
-                %or $rest
-            } {
-                result $result
-            }
-        }
-    }
-}
+fn-%not        = $&negate
+fn-%and        = $&andalso
+fn-%or         = $&orelse
 
 #    Background commands could use the $&background primitive directly,
 #    but some of the user-friendly semantics ($apid, printing of the
@@ -691,6 +637,7 @@ fn %interactive-loop {
             throw retry # restart forever loop
         } {
             forever {
+                $&collect -idle
                 if {!~ $#fn-%prompt 0} {
                     %prompt
                 }
@@ -750,6 +697,25 @@ set-PATH = @ { local (set-path = ) path = <={%fsplit  : $*}; result $* }
 set-signals        = $&setsignals
 set-noexport        = $&setnoexport
 set-max-eval-depth    = $&setmaxevaldepth
+set-max-heap-size    = $&setmaxheapsize
+
+#    If function-table names a directory, exported functions are written
+#    to a file there instead of being put in the environment, and child
+#    shells read them back from it.  The directory should be private.
+
+set-function-table    = $&setfunctiontable
+
+#    The gc-* variables tune how the garbage collector sizes its spaces:
+#    after a major collection new space grows to gc-growth-factor times
+#    the live data, shrinks back to that once it exceeds gc-shrink-threshold
+#    times the live data, and is never smaller than gc-min-space bytes.
+#    If gc-max-pause is not zero, new space is also kept small enough
+#    that collecting it should take no more than that many microseconds.
+
+set-gc-growth-factor    = $&setgcgrowth
+set-gc-shrink-threshold    = $&setgcshrink
+set-gc-min-space    = $&setgcminspace
+set-gc-max-pause    = $&setgcmaxpause
 
 #    If the primitives $&sethistory or $&resetterminal are defined (meaning
 #    that readline or editline is being used), setting the variables $TERM,
@@ -788,6 +754,10 @@ home              = /
 ifs               = ' ' \t \n
 prompt            = '; ' ''
 max-eval-depth    = 640
+gc-growth-factor  = 4
+gc-shrink-threshold = 12
+gc-min-space      = 10000
+gc-max-pause      = 0
 
 #    noexport lists the variables that are not exported.  It is not
 #    exported, because none of the variables that it refers to are
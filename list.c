@@ -2,6 +2,7 @@
 
 #include "es.h"
 #include "gc.h"
+#include "term.h"
 
 /*
  * Allocation and garbage collector support
@@ -11,18 +12,23 @@ DefineTag(List, static);
 
 /* mklist -- create a new list node with given term and next pointer */
 extern List *mklist(Term *term, List *next)
-{   gcdisable();
+{   List *list;
     assert(term != NULL);
-    Ref(List *, list, gcnew(List));
+    if (GCNEEDRESERVE(GCSIZE(List)))
+    {   RefAdd2(term, next);
+        gcreserve(GCSIZE(List));
+        RefRemove2(next, term);
+    }
+    list       = gcnewreserved(List);
     list->term = term;
     list->next = next;
-    gcenable();
-    RefReturn(list);
+    return list;
 }
 
 static void *ListCopy(void *original_ptr)
 {   void *new_ptr = gcnew(List);
     memcpy(new_ptr, original_ptr, sizeof(List));
+    forwardahead(((List *) new_ptr)->term);
     return new_ptr;
 }
 
@@ -49,6 +55,7 @@ extern List *reverse(List *list)
     do
     {   next_node     = list->next;
         list->next    = previous_node;
+        gcremember(list);
         previous_node = list;
     }
 	while ((list = next_node) != NULL);
@@ -58,33 +65,28 @@ extern List *reverse(List *list)
 
 /* append -- merge two lists non-destructively with smart memory reservation */
 extern List *append(List *head, List *tail)
-{   List *current_list;
+{   List  *current_list;
     List **previous_ptr;
+    size_t needed = length(head) * GCSIZE(List);
     
-    Ref(List *, head_ptr, head);
-    Ref(List *, tail_ptr, tail);
-    
-    /* Pre-allocate memory to reduce GC pressure during construction */
-    gcreserve(40 * sizeof(List));
-    gcdisable();
-    
-    head = head_ptr;
-    tail = tail_ptr;
-    RefEnd2(tail_ptr, head_ptr);
+    /* Reserve every node up front, so that nothing collects below */
+    if (GCNEEDRESERVE(needed))
+    {   RefAdd2(head, tail);
+        gcreserve(needed);
+        RefRemove2(tail, head);
+    }
 
     /* Copy head list nodes */
     for (previous_ptr  = &current_list; head != NULL; head = head->next)
-    {   List *new_node = mklist(head->term, NULL);
+    {   List *new_node = gcnewreserved(List);
+        new_node->term = head->term;
         *previous_ptr  = new_node;
         previous_ptr   = &new_node->next;
     }
     
     /* Attach tail without copying */
     *previous_ptr = tail;
-
-    Ref(List *, result, current_list);
-    gcenable();
-    RefReturn(result);
+    return current_list;
 }
 
 /* prepend -- add a single term to the front of a list non-destructively */
@@ -112,6 +114,9 @@ extern int length(List *list)
 extern List *listify(int argc, char **argv)
 {   Ref(List *, list, NULL);
     
+    /* Reserve all the terms and nodes, so that only GCALWAYS builds collect below */
+    gcreserve(argc * (GCSIZE(Term) + GCSIZE(List)));
+    
     /* Build list in reverse order for efficiency */
     while (argc > 0)
     {   Term *term = mkstr(argv[--argc]);
@@ -6,8 +6,11 @@
 PRIM(seq) {
 	Ref(List *, result, ltrue);
 	Ref(List *, lp, list);
-	for (; lp != NULL; lp = lp->next)
-		result = eval1(lp->term, evalflags &~ (lp->next == NULL ? 0 : eval_inchild));
+	for (; lp != NULL; lp = lp->next) {
+		result = eval1(lp->term, evalflags &~ (lp->next == NULL ? 0 : eval_inchild|eval_tail));
+		if (isunwinding(result))
+			break;
+	}
 	RefEnd(lp);
 	RefReturn(result);
 }
@@ -17,7 +20,11 @@ PRIM(if) {
 	for (; lp != NULL; lp = lp->next) {
 		List *cond = ltrue;
 		if (lp->next != NULL) {
-			cond = eval1(lp->term, 0);
+			cond = eval1(lp->term, evalflags & eval_unwinding);
+			if (isunwinding(cond)) {
+				RefPop(lp);
+				return cond;
+			}
 			lp = lp->next;
 		}
 		if (istrue(cond)) {
@@ -38,9 +45,89 @@ PRIM(forever) {
 	return list;
 }
 
+PRIM(while) {
+	int flags = (evalflags & eval_return) | eval_break;
+	Ref(List *, result, ltrue);
+	Ref(List *, body, list == NULL ? NULL : list->next);
+	Ref(List *, cond, list == NULL ? NULL : mklist(list->term, NULL));
+
+	ExceptionHandler
+
+		for (;;) {
+			List *test = eval(cond, NULL, flags);
+			if (test == &breakmark) {
+				result = unwound();
+				break;
+			}
+			if (test == &returnmark) {
+				result = test;
+				break;
+			}
+			if (!istrue(test))
+				break;
+			result = eval(body, NULL, flags);
+			if (result == &breakmark) {
+				result = unwound();
+				break;
+			}
+			if (result == &returnmark)
+				break;
+		}
+
+	CatchException (e)
+
+		if (!termeq(e->term, "break"))
+			throw(e);
+		result = e->next;
+
+	EndExceptionHandler
+
+	RefEnd2(cond, body);
+	RefReturn(result);
+}
+
+PRIM(negate) {
+	List *result = eval(list, NULL, evalflags & eval_unwinding);
+	if (isunwinding(result))
+		return result;
+	return istrue(result) ? lfalse : ltrue;
+}
+
+PRIM(andalso) {
+	Ref(List *, result, ltrue);
+	Ref(List *, lp, list);
+	for (; lp != NULL; lp = lp->next) {
+		result = eval1(lp->term, evalflags & (lp->next == NULL
+						      ? eval_unwinding|eval_tail
+						      : eval_unwinding));
+		if (isunwinding(result) || !istrue(result))
+			break;
+	}
+	RefEnd(lp);
+	RefReturn(result);
+}
+
+PRIM(orelse) {
+	Ref(List *, result, lfalse);
+	Ref(List *, lp, list);
+	for (; lp != NULL; lp = lp->next) {
+		result = eval1(lp->term, evalflags & (lp->next == NULL
+						      ? eval_unwinding|eval_tail
+						      : eval_unwinding));
+		if (isunwinding(result) || istrue(result))
+			break;
+	}
+	RefEnd(lp);
+	RefReturn(result);
+}
+
 PRIM(throw) {
 	if (list == NULL)
 		fail("$&throw", "usage: throw exception [args ...]");
+	if ((evalflags & eval_return) && termeq(list->term, "return"))
+		return evalreturn(list->next);
+	if ((evalflags & eval_break) && termeq(list->term, "break"))
+		return evalbreak(list->next);
 	throw(list);
 	NOTREACHED;
 }
@@ -91,9 +178,13 @@ PRIM(catch) {
 }
 
 extern Dict *initprims_controlflow(Dict *primdict) {
-	X(seq);
-	X(if);
-	X(throw);
+	XUNWIND(seq);
+	XUNWIND(if);
+	XUNWIND(throw);
+	XUNWIND(while);
+	XUNWIND(negate);
+	XUNWIND(andalso);
+	XUNWIND(orelse);
 	X(forever);
 	X(catch);
 	return primdict;
@@ -29,6 +29,14 @@ PRIM(setnoexport) {
 	RefReturn(lp);
 }
 
+PRIM(setfunctiontable) {
+	if (list != NULL && list->next != NULL)
+		fail("$&setfunctiontable", "usage: $&setfunctiontable [directory]");
+	Ref(List *, lp, list);
+	setfunctiontable(lp == NULL ? NULL : getstr(lp->term));
+	RefReturn(lp);
+}
+
 PRIM(version) {
 	return mklist(mkstr((char *) version), NULL);
 }
@@ -103,7 +111,7 @@ PRIM(whatis) {
 				if (error != NULL)
 					fail("$&whatis", "%s: %s", prog, error);
 			} else
-				list = pathsearch(term);
+				list = pathsearch(term, 0);
 		}
 		RefEnd(prog);
 	}
@@ -237,10 +245,49 @@ PRIM(batchloop) {
 }
 
 PRIM(collect) {
-	gc();
+	if (list == NULL)
+		gc();
+	else if (list->next == NULL && termeq(list->term, "-shrink"))
+		gcshrinkheap();
+	else if (list->next == NULL && termeq(list->term, "-idle"))
+		gcidle();
+	else
+		fail("$&collect", "usage: $&collect [-shrink | -idle]");
 	return ltrue;
 }
 
+/* gcstat -- add a name and value to the front of a $&gcstats result */
+static List *gcstat(List *list, char *name, unsigned long value) {
+	Term *term;
+	Ref(List *, lp, list);
+	term = mkstr(str("%uld", value));
+	lp = mklist(term, lp);
+	term = mkstr(name);
+	lp = mklist(term, lp);
+	RefReturn(lp);
+}
+
+PRIM(gcstats) {
+	GCStats stats;
+	if (list != NULL)
+		fail("$&gcstats", "usage: $&gcstats");
+	gcstats(&stats);
+	list = gcstat(NULL, "peak", stats.peak);
+	list = gcstat(list, "frozen", stats.frozen);
+	list = gcstat(list, "large", stats.large);
+	list = gcstat(list, "code", stats.code);
+	list = gcstat(list, "pspace", stats.pspace);
+	list = gcstat(list, "tenured", stats.tenured);
+	list = gcstat(list, "nursery", stats.nursery);
+	list = gcstat(list, "pseals", stats.pseals);
+	list = gcstat(list, "pause-max", stats.pausemax);
+	list = gcstat(list, "pause-total", stats.pausetotal);
+	list = gcstat(list, "copied", stats.copied);
+	list = gcstat(list, "majors", stats.majors);
+	list = gcstat(list, "collections", stats.collections);
+	return list;
+}
+
 PRIM(home) {
 	struct passwd *pw;
 	if (list == NULL)
@@ -275,7 +322,7 @@ PRIM(noreturn) {
 		fail("$&noreturn", "$&noreturn: %E is not a lambda", lp->term);
 	Ref(Tree *, tree, closure->tree);
 	Ref(Binding *, context, bindargs(tree->u[0].p, lp->next, closure->binding));
-	lp = walk(tree->u[1].p, context, evalflags);
+	lp = walkbody(tree->u[1].p, context, evalflags);
 	RefEnd3(context, tree, closure);
 	RefReturn(lp);
 }
@@ -299,6 +346,98 @@ PRIM(setmaxevaldepth) {
 	RefReturn(lp);
 }
 
+/* gcsetting -- parse the value given to one of the gc-* settor variables */
+static unsigned long gcsetting(char *prim, char *var, List *list, unsigned long min) {
+	char *s;
+	long n;
+	if (list->next != NULL)
+		fail(prim, "usage: %s [value]", prim);
+	n = strtol(getstr(list->term), &s, 0);
+	if (n < (long) min || (s != NULL && *s != '\0'))
+		fail(prim, "%s must be set to an integer no less than %uld", var, min);
+	return n;
+}
+
+#define	NCENSUS	32	/* more than the number of kinds of objects */
+
+static int cmpcensus(const void *p1, const void *p2) {
+	const GCCensus *c1 = p1, *c2 = p2;
+	if (c1->bytes != c2->bytes)
+		return (c1->bytes < c2->bytes) ? 1 : -1;
+	return strcmp(c1->name, c2->name);
+}
+
+PRIM(heapcensus) {
+	GCCensus census[NCENSUS];
+	int i, n;
+	if (list != NULL) {
+		if (list->next == NULL && termeq(list->term, "-vars"))
+			return varcensus();
+		fail("$&heapcensus", "usage: $&heapcensus [-vars]");
+	}
+	n = gccensus(census, NCENSUS);
+	qsort(census, n, sizeof (GCCensus), cmpcensus);
+	for (i = n; i-- > 0;) {
+		Term *term;
+		Ref(List *, lp, list);
+		term = mkstr(str("%uld", (unsigned long) census[i].bytes));
+		lp = mklist(term, lp);
+		list = gcstat(lp, census[i].name, census[i].count);
+		RefEnd(lp);
+	}
+	return list;
+}
+
+PRIM(setgcgrowth) {
+	if (list == NULL) {
+		gcgrowth = DEFgcgrowth;
+		return NULL;
+	}
+	Ref(List *, lp, list);
+	gcgrowth = gcsetting("$&setgcgrowth", "gc-growth-factor", lp, 2);
+	RefReturn(lp);
+}
+
+PRIM(setgcshrink) {
+	if (list == NULL) {
+		gcshrink = DEFgcshrink;
+		return NULL;
+	}
+	Ref(List *, lp, list);
+	gcshrink = gcsetting("$&setgcshrink", "gc-shrink-threshold", lp, 2);
+	RefReturn(lp);
+}
+
+PRIM(setgcminspace) {
+	if (list == NULL) {
+		gcminspace = DEFgcminspace;
+		return NULL;
+	}
+	Ref(List *, lp, list);
+	gcminspace = gcsetting("$&setgcminspace", "gc-min-space", lp, MINgcminspace);
+	RefReturn(lp);
+}
+
+PRIM(setmaxheapsize) {
+	if (list == NULL) {
+		gcmaxheap = 0;
+		return NULL;
+	}
+	Ref(List *, lp, list);
+	gcmaxheap = gcsetting("$&setmaxheapsize", "max-heap-size", lp, 0);
+	RefReturn(lp);
+}
+
+PRIM(setgcmaxpause) {
+	if (list == NULL) {
+		gcmaxpause = DEFgcmaxpause;
+		return NULL;
+	}
+	Ref(List *, lp, list);
+	gcmaxpause = gcsetting("$&setgcmaxpause", "gc-max-pause", lp, 0);
+	RefReturn(lp);
+}
+
 #if HAVE_READLINE
 PRIM(sethistory) {
 	if (list == NULL) {
@@ -445,27 +584,35 @@ PRIM(help) {
  */
 
 extern Dict *initprims_etc(Dict *primdict) {
-        X(echo);
-        X(version);
+        XPURE(echo);
+        XPURE(version);
         X(exec);
         X(dot);
-        X(flatten);
+        XPURE(flatten);
         X(whatis);
-        X(split);
-	X(fsplit);
-	X(var);
+        XPURE(split);
+	XPURE(fsplit);
+	XPURE(var);
 	X(parse);
 	X(batchloop);
-	X(collect);
-	X(home);
+	XPURE(collect);
+	XPURE(heapcensus);
+	XPURE(gcstats);
+	XPURE(home);
 	X(setnoexport);
-	X(vars);
-	X(internals);
-	X(result);
-	X(isinteractive);
+	X(setfunctiontable);
+	XPURE(vars);
+	XPURE(internals);
+	XPURE(result);
+	XPURE(isinteractive);
 	X(exitonfalse);
-	X(noreturn);
+	XUNWIND(noreturn);
 	X(setmaxevaldepth);
+	X(setgcgrowth);
+	X(setgcshrink);
+	X(setgcminspace);
+	X(setgcmaxpause);
+	X(setmaxheapsize);
 	X(help);
 #if HAVE_READLINE
 	X(sethistory);
@@ -96,6 +96,8 @@ PRIM(openfile) {
 	lp = list->next;
 	list->next = lp->next;
 	lp->next = list;
+	gcremember(list);
+	gcremember(lp);
 	return redir(redir_openfile, lp, evalflags);
 }
 
@@ -613,44 +613,44 @@ PRIM(intdivision)
 
 extern Dict *initprims_math(Dict *primdict)
 {   /* Arithmetic operations */
-    X(addition);
-    X(subtraction);
-    X(multiplication);
-    X(division);
-    X(modulo);
-    X(pow);
-    X(abs);
-    X(min);
-    X(max);
-    X(count);
+    XPURE(addition);
+    XPURE(subtraction);
+    XPURE(multiplication);
+    XPURE(division);
+    XPURE(modulo);
+    XPURE(pow);
+    XPURE(abs);
+    XPURE(min);
+    XPURE(max);
+    XPURE(count);
     
     /* Integer-only arithmetic operations */
-    X(intaddition);
-    X(intsubtraction);
-    X(intmultiplication);
-    X(intdivision);
+    XPURE(intaddition);
+    XPURE(intsubtraction);
+    XPURE(intmultiplication);
+    XPURE(intdivision);
     
     /* Type conversion operations */
-    X(toint);
-    X(tofloat);
-    X(isint);
-    X(isfloat);
+    XPURE(toint);
+    XPURE(tofloat);
+    XPURE(isint);
+    XPURE(isfloat);
     
     /* Bitwise operations */
-    X(bitwiseshiftleft);
-    X(bitwiseshiftright);
-    X(and);
-    X(or);
-    X(xor);
-    X(not);
+    XPURE(bitwiseshiftleft);
+    XPURE(bitwiseshiftright);
+    XPURE(and);
+    XPURE(or);
+    XPURE(xor);
+    XPURE(not);
     
     /* Comparison operations */
-    X(greater);
-    X(less);
-    X(greaterequal);
-    X(lessequal);
-    X(equal);
-    X(notequal);
+    XPURE(greater);
+    XPURE(less);
+    XPURE(greaterequal);
+    XPURE(lessequal);
+    XPURE(equal);
+    XPURE(notequal);
     
     return primdict;
 }
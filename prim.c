@@ -5,11 +5,36 @@
 
 static Dict *prims;
 
+/* catchreturn -- call a primitive which may run code, handing a thrown return back as returnmark */
+static List *catchreturn(Prim *p, List *list, Binding *binding, int evalflags) {
+	List *volatile result = NULL;
+
+	ExceptionHandler
+
+		result = (p->prim)(list, binding, evalflags);
+
+	CatchException (e)
+
+		if (!termeq(e->term, "return"))
+			throw(e);
+		result = evalreturn(e->next);
+
+	EndExceptionHandler
+
+	return result;
+}
+
 extern List *prim(char *s, List *list, Binding *binding, int evalflags) {
 	Prim *p;
 	p = (Prim *) dictget(prims, s);
 	if (p == NULL)
 		fail("es:prim", "unknown primitive: %s", s);
+	if (!p->unwinds) {
+		Boolean catching = (evalflags & eval_return) && !p->pure;
+		evalflags &= ~(eval_tail|eval_unwinding);
+		if (catching)
+			return catchreturn(p, list, binding, evalflags);
+	}
 	return (p->prim)(list, binding, evalflags);
 }
 
@@ -50,5 +75,5 @@ extern void initprims(void) {
 	prims = initprims_access(prims);
 
 #define	primdict prims
-	X(primitives);
+	XPURE(primitives);
 }
@@ -1,17 +1,32 @@
 /* prim.h -- definitions for es primitives ($Revision: 1.1.1.1 $) */
 
-typedef struct { List *(*prim)(List *, Binding *, int); } Prim;
+typedef struct {
+	List *(*prim)(List *, Binding *, int);
+	Boolean unwinds;		/* does it handle eval_tail, eval_return and eval_break? */
+	Boolean pure;			/* is it sure never to run any es code? */
+} Prim;
 
 #define	PRIM(name)	static List *CONCAT(prim_,name)( \
 				List UNUSED *list, Binding UNUSED *binding, int UNUSED evalflags \
 			)
-#define	X(name)		STMT( \
-			static Prim CONCAT(prim_struct_,name) = { CONCAT(prim_,name) }; \
+#define	XPRIM(name, unwind, nocode) \
+			STMT( \
+			static Prim CONCAT(prim_struct_,name); \
+			CONCAT(prim_struct_,name).prim = CONCAT(prim_,name); \
+			CONCAT(prim_struct_,name).unwinds = (unwind); \
+			CONCAT(prim_struct_,name).pure = (nocode); \
 			primdict = dictput( \
 				primdict, \
 				STRING(name), \
 				(void *) &CONCAT(prim_struct_,name) \
 			))
+#define	X(name)		XPRIM(name, FALSE, FALSE)
+
+/* for primitives which handle tail calls and returns; see eval.c */
+#define	XUNWIND(name)	XPRIM(name, TRUE, FALSE)
+
+/* for primitives which run no code, so no return can be thrown through them */
+#define	XPURE(name)	XPRIM(name, FALSE, TRUE)
 
 extern Dict *initprims_controlflow(Dict *primdict);	/* prim-ctl.c */
 extern Dict *initprims_io(         Dict *primdict); /* prim-io.c */
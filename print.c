@@ -49,9 +49,9 @@ static void pad(Format *format, long len, int c) {
 static Boolean sconv(Format *format) {
 	char *s = va_arg(format->args, char *);
 	if ((format->flags & FMT_f1set) == 0)
-		fmtcat(format, s);
+		fmtappend(format, s, gcstrlen(s));
 	else {
-		size_t len = strlen(s), width = format->f1 - len;
+		size_t len = gcstrlen(s), width = format->f1 - len;
 		if (format->flags & FMT_leftside) {
 			fmtappend(format, s, len);
 			pad(format, width, ' ');
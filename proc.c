@@ -32,7 +32,9 @@ extern Proc *mkproc(int pid, Boolean background) {
 /* efork -- fork (if necessary) and clean up as appropriate */
 extern int efork(Boolean parent, Boolean background) {
 	if (parent) {
-		int pid = fork();
+		int pid;
+		sharefntable();
+		pid = fork();
 		switch (pid) {
 		default: {	/* parent */
 			Proc *proc = mkproc(pid, background);
@@ -48,6 +50,7 @@ extern int efork(Boolean parent, Boolean background) {
 				efree(p);
 			}
 			hasforked = TRUE;
+			gcfreeze();
 #if JOB_PROTECT
 			tcpgid0 = 0;
 #endif
@@ -132,6 +135,11 @@ static Proc *reap(int pid) {
 	return proc;
 }
 
+/* haschildren -- is any process this shell started not yet waited for? */
+extern Boolean haschildren(void) {
+	return proclist != NULL;
+}
+
 /* ewait -- wait for a specific process to die, or any process if pid == -1 */
 extern int ewait(int pidarg, Boolean interruptible) {
 	int deadpid, status;
@@ -186,7 +194,7 @@ PRIM(wait) {
 }
 
 extern Dict *initprims_proc(Dict *primdict) {
-	X(apids);
+	XPURE(apids);
 	X(wait);
 	return primdict;
 }
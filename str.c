@@ -166,15 +166,19 @@ DefineTag(StrList, static);
  * Returns: new StrList node in GC space
  */
 extern StrList *mkstrlist(char *string, StrList *next)
-{   gcdisable();
+{   StrList *new_list;
     assert(string != NULL);
     
-    Ref(StrList *, new_list, gcnew(StrList));
+    if (GCNEEDRESERVE(GCSIZE(StrList)))
+    {   RefAdd2(string, next);
+        gcreserve(GCSIZE(StrList));
+        RefRemove2(next, string);
+    }
+    
+    new_list       = gcnewreserved(StrList);
     new_list->str  = string;
     new_list->next = next;
-    gcenable();
-    
-    RefReturn(new_list);
+    return new_list;
 }
 
 static void *StrListCopy(void *original_ptr)
@@ -7,22 +7,20 @@
 DefineTag(Term, static);
 
 extern Term *mkterm(char *str, Closure *closure) {
-	gcdisable();
-	Ref(Term *, term, gcnew(Term));
+	Term *term;
+	if (GCNEEDRESERVE(GCSIZE(Term))) {
+		RefAdd2(str, closure);
+		gcreserve(GCSIZE(Term));
+		RefRemove2(closure, str);
+	}
+	term = gcnewreserved(Term);
 	term->str = str;
 	term->closure = closure;
-	gcenable();
-	RefReturn(term);
+	return term;
 }
 
 extern Term *mkstr(char *str) {
-	Term *term;
-	Ref(char *, string, str);
-	term = gcnew(Term);
-        term->str = string;
-	term->closure = NULL;
-        RefEnd(string);
-        return term;
+	return mkterm(str, NULL);
 }
 
 extern Closure *getclosure(Term *term) {
@@ -44,6 +42,7 @@ extern Closure *getclosure(Term *term) {
 			c = extractbindings(np);
 			tp->closure = c;
 			tp->str = NULL;
+			gcremember(tp);
 			term = tp;
 			RefEnd2(np, tp);
 		}
@@ -71,6 +70,8 @@ extern char *getstr(Term *term) {
 }
 
 extern Term *termcat(Term *t1, Term *t2) {
+	char *s;
+	size_t len1, len2;
 	if (t1 == NULL)
 		return t2;
 	if (t2 == NULL)
@@ -79,7 +80,13 @@ extern Term *termcat(Term *t1, Term *t2) {
 	Ref(Term *, term, mkstr(NULL));
 	Ref(char *, str1, getstr(t1));
 	Ref(char *, str2, getstr(t2));
-	term->str = str("%s%s", str1, str2);
+	len1 = gcstrlen(str1);
+	len2 = gcstrlen(str2);
+	s = gcalloc(len1 + len2 + 1, &StringTag);
+	memcpy(s, str1, len1);
+	memcpy(s + len1, str2, len2 + 1);
+	term->str = s;
+	gcremember(term);
 	RefEnd2(str2, str1);
 	RefReturn(term);
 }
@@ -88,6 +95,7 @@ extern Term *termcat(Term *t1, Term *t2) {
 static void *TermCopy(void *op) {
 	void *np = gcnew(Term);
 	memcpy(np, op, sizeof (Term));
+	forwardahead(((Term *) np)->str);
 	return np;
 }
 
@@ -0,0 +1,106 @@
+# tests/call.es -- verify function calls, tail calls and returns
+
+test 'tail calls' {
+	fn call-test-count n acc {
+		if {~ $n 0} {
+			result $acc
+		} {
+			call-test-count <={$&intsubtraction $n 1} x
+		}
+	}
+	local (max-eval-depth = 200)
+		assert {~ <={call-test-count 5000} x} 'tail recursion runs in constant depth'
+	fn call-test-outer {call-test-inner}
+	fn call-test-inner {result $0}
+	assert {~ <={call-test-outer} call-test-inner} 'a tail call sets $0'
+	fn call-test-outer {@ {result $0}}
+	assert {~ <={call-test-outer} call-test-outer} 'an anonymous tail call keeps $0'
+	fn call-test-outer {local (call-test-var = inner) call-test-inner}
+	fn call-test-inner {result $call-test-var}
+	assert {~ <={call-test-outer} inner} 'local is undone after the call'
+	fn-call-test-count = ()
+	fn-call-test-outer = ()
+	fn-call-test-inner = ()
+}
+
+test 'returns' {
+	fn call-test-fn {
+		if {~ $1 early} {return early}
+		for (i = 1 2 3) {
+			if {~ $i $1} {return loop}
+		}
+		if {~ $1 catch} {
+			catch @ e {return $e} {throw caught}
+		}
+		return last
+	}
+	for ((how want) = (early early 2 loop catch caught last last))
+		assert {~ <={call-test-fn $how} $want} 'return '^$how
+	fn call-test-fn {call-test-var = <={return inner}; result outer}
+	assert {~ <={call-test-fn} inner} 'return from a nested call'
+	fn call-test-returner {return ignored}
+	set-call-test-var = @ {call-test-returner; result $*}
+	fn call-test-fn {local (call-test-var = 1) {return hello}}
+	assert {~ <={call-test-fn} hello} 'return through local with a settor'
+	set-call-test-var = ()
+	fn-call-test-returner = ()
+	let (exception = ()) {
+		catch @ e {exception = $e} {return 1}
+		assert {~ $exception return} 'return outside a function still throws'
+	}
+	fn-call-test-fn = ()
+	call-test-var = ()
+}
+
+test 'thrown returns' {
+	fn call-test-run {$1}
+	fn call-test-fn {call-test-run {call-test-var = <={return inner}}; result outer}
+	assert {~ <={call-test-fn} outer} 'return in a thunk leaves the function running it'
+	fn call-test-fn {call-test-run @ {return lambda}; result outer}
+	assert {~ <={call-test-fn} outer} 'return in a lambda leaves only the lambda'
+	fn call-test-fn {forever {return loop}}
+	assert {~ <={call-test-fn} loop} 'return from forever'
+	fn call-test-fn {let (x = <={return let}) result no}
+	assert {~ <={call-test-fn} let} 'return from a let binding'
+	fn call-test-fn {$&noreturn @ {call-test-var = <={return through}}; result no}
+	assert {~ <={call-test-fn} through} 'return through noreturn'
+	fn call-test-fn {if {true} {call-test-run {return if}}; result no}
+	assert {~ <={call-test-fn} no} 'return in a thunk under if'
+	fn-call-test-run = ()
+	fn-call-test-fn = ()
+	call-test-var = ()
+}
+
+test 'breaks and logical operators' {
+	let (n = 0) {
+		assert {~ <={while {true} {n = <={$&intaddition $n 1}; ~ $n 3 && break done $n}} (done 3)} 'break from while'
+		assert {~ <={while {!~ $n 5} {n = <={$&intaddition $n 1}; result $n}} 5} 'while returns the last result'
+	}
+	fn call-test-fn {break from function}
+	assert {~ <={while {true} {call-test-fn}} (from function)} 'break thrown from a function'
+	assert {~ <={for (i = 1 2 3) {local (call-test-var = $i) ~ $i 2 && break $i}} 2} 'break from for and local'
+	assert {~ $#call-test-var 0} 'local is undone by break'
+	fn call-test-returner {return ignored}
+	set-call-test-var = @ {call-test-returner; result $*}
+	assert {~ <={while {true} {local (call-test-var = 1) {break brk}}} brk} 'break through local with a settor'
+	set-call-test-var = ()
+	fn-call-test-returner = ()
+	let (caught = ()) {
+		while {true} {catch @ e {caught = $e} {break inner}; break}
+		assert {~ $caught (break inner)} 'catch still sees a break'
+	}
+	fn call-test-fn {
+		while {true} {
+			for (i = 1 2) {~ $i 2 && return $1 $i}
+		}
+	}
+	assert {~ <={call-test-fn loop} (loop 2)} 'return from nested loops'
+	assert {~ <={%and} 0 && ~ <={%or} 1} 'empty logical operators'
+	assert {~ <={%and {true} {result 7}} 7 && ~ <={%or {false} {result 8}} 8} 'last result is kept'
+	assert {~ <={%and {false} {result 7}} 1 && ~ <={%or {result 0} {result 8}} 0} 'short circuit'
+	assert {! ~ <={! true} 0 && ~ <={! false} 0} 'not'
+	fn call-test-fn n {~ $n 0 || call-test-fn <={$&intsubtraction $n 1}}
+	local (max-eval-depth = 200)
+		assert {call-test-fn 1000} '%or makes a tail call'
+	fn-call-test-fn = ()
+}
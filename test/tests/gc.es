@@ -0,0 +1,191 @@
+# tests/gc.es -- verify values survive collections while being updated
+
+# churn makes enough short-lived garbage to force several collections.
+fn churn n {
+	for (i = `{seq 1 $n}) {
+		let (junk = a b c d e f g h i j k l m n o p)
+			junk = $junk^$i
+	}
+}
+
+# gcstat picks one statistic out of the name/value pairs from $&gcstats.
+fn gcstat name stats {
+	for ((n v) = $stats)
+		if {~ $n $name} {return $v}
+	throw error gcstat 'no statistic '^$name
+}
+
+# pagedspaces is true in GCPROTECT builds, which round every space to
+# whole pages and reuse a space rather than shrink it.
+fn pagedspaces {
+	let (stats = <=$&gcstats) {
+		for (space = nursery tenured pspace code)
+			let (size = <={gcstat $space $stats})
+				if {!~ $size <={$&intmultiplication <={$&intdivision $size 4096} 4096}} {
+					return 1
+				}
+		return 0
+	}
+}
+
+test 'globals updated across collections' {
+	let (acc = ()) {
+		for (i = `{seq 1 200}) {
+			acc = $acc $i
+			churn 5
+		}
+		assert {~ $#acc 200} 'all elements kept'
+		assert {~ $acc(1) 1 && ~ $acc(200) 200} 'ends of the list are intact'
+	}
+}
+
+test 'let bindings updated across collections' {
+	let (count = (); words = ()) {
+		for (i = `{seq 1 100}) {
+			count = $count x
+			words = word$i $words
+			churn 5
+		}
+		assert {~ $#count 100} 'binding defn is current'
+		assert {~ $words(1) word100 && ~ $words(100) word1} 'binding list is intact'
+	}
+}
+
+test 'closures keep their bindings' {
+	let (fns = ()) {
+		for (i = `{seq 1 50}) {
+			let (n = $i)
+				fns = $fns {result $n}
+			churn 3
+		}
+		$&collect
+		assert {~ <={$fns(1)} 1} 'first closure'
+		assert {~ <={$fns(50)} 50} 'last closure'
+	}
+}
+
+test 'local survives collections' {
+	gc-test-var = outer
+	local (gc-test-var = inner) {
+		churn 20
+		$&collect
+		assert {~ $gc-test-var inner} 'inner value kept'
+	}
+	churn 20
+	assert {~ $gc-test-var outer} 'outer value restored'
+	gc-test-var = ()
+}
+
+test 'gc statistics' {
+	let (before = <=$&gcstats; after = ()) {
+		churn 20
+		$&collect
+		after = <=$&gcstats
+		assert {~ $before(1) collections && ~ $#before 26} 'names and values alternate'
+		assert {!~ $before(2) $after(2)} 'collections are counted'
+	}
+	let (exception = ()) {
+		catch @ e {exception = $e} {gc-growth-factor = 1}
+		assert {~ $exception(1) error} 'growth factor is checked'
+	}
+	assert {~ $gc-growth-factor 4} 'growth factor is unchanged'
+}
+
+test 'large strings' {
+	let (big = <={%flatten '' `{seq 1 3000}}; parts = ()) {
+		for (i = `{seq 1 20}) {
+			parts = $parts <={%flatten - $big $i}
+			churn 5
+		}
+		$&collect
+		assert {~ $#parts 20} 'all strings kept'
+		assert {~ $parts(20) *-20 && ~ $parts(1) 123* } 'contents are intact'
+		assert {~ <={%flatten '' `{seq 1 3000}} $big} 'large string unchanged'
+	}
+}
+
+test 'sealed code survives compaction' {
+	for (i = `{seq 1 300})
+		eval 'fn gc-test-fn'^$i^' { result '^$i^' }'
+	for (i = `{seq 1 2000})
+		eval 'gc-test-var = '^$i
+	$&collect
+	assert {~ <={gc-test-fn1} 1 && ~ <={gc-test-fn300} 300} 'functions still run'
+	assert {~ $gc-test-var 2000} 'last assignment kept'
+	for (i = `{seq 1 300})
+		fn-gc-test-fn$i = ()
+	gc-test-var = ()
+}
+
+test 'forked children collect their own heap' {
+	let (acc = `{seq 1 50}) {
+		let (out = `{
+			for (i = `{seq 51 100}) {
+				acc = $acc $i
+				churn 3
+			}
+			$&collect
+			echo $#acc $acc(100) <={gcstat frozen <=$&gcstats}
+		}) {
+			assert {~ $out(1) 100 && ~ $out(2) 100} 'child kept its updates'
+			assert {!~ $out(3) 0} 'child reports the inherited heap'
+		}
+		assert {~ $#acc 50} 'parent is untouched'
+	}
+}
+
+test 'shrinking the heap' {
+	let (peak = (); after = ()) {
+		let (big = `{seq 1 30000}) {
+			$&collect
+			peak = <=$&gcstats
+		}
+		$&collect -shrink
+		after = <=$&gcstats
+		assert {pagedspaces || ~ <={$&intsubtraction <={gcstat nursery $peak} <={gcstat nursery $after}} [1-9]*} 'nursery shrinks after a peak'
+	}
+	let (exception = ()) {
+		catch @ e {exception = $e} {$&collect -bogus}
+		assert {~ $exception(1) error} 'bad option is rejected'
+	}
+}
+
+test 'heap census' {
+	let (census = <=$&heapcensus)
+		assert {~ $census List && ~ $census String} 'objects are counted by type'
+	gc-test-var = `{seq 1 2000}
+	let (sizes = <={$&heapcensus -vars})
+		assert {~ $sizes(1) gc-test-var} 'largest variable comes first'
+	gc-test-var = ()
+}
+
+test 'pause budget' {
+	let (before = ()) {
+		churn 50
+		$&collect
+		before = <={gcstat nursery <=$&gcstats}
+		local (gc-max-pause = 1) {
+			churn 50
+			$&collect
+			$&collect -idle
+			assert {pagedspaces || ~ <={$&intsubtraction <={gcstat nursery <=$&gcstats} $before} -*} 'nursery is kept small'
+		}
+	}
+	assert {~ $gc-max-pause 0} 'budget is restored'
+}
+
+test 'heap limit' {
+	let (exception = (); limit = 1000000) {
+		$&collect
+		let (stats = <=$&gcstats)
+			for (space = tenured pspace code large)
+				limit = <={$&intaddition $limit <={gcstat $space $stats}}
+		local (max-heap-size = $limit)
+			catch @ e {exception = $e} {
+				let (x = a)
+					forever {x = $x $x}
+			}
+		assert {~ $exception(1 2) error es:heap} 'runaway growth is stopped'
+	}
+	assert {~ $#max-heap-size 0} 'limit is restored'
+}
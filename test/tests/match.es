@@ -94,3 +94,17 @@ test 'error handling' {
 		rm -f $stderr
 	}
 }
+
+# Patterns are compiled once, so quoting has to follow each word
+# through concatenation just as it does when the tree is walked.
+test 'quoting in compiled patterns' {
+	let (star = '*'; close = ']') {
+		for (i = 1 2) {
+			assert {~ 'a*' a^'*' && !~ ab a^'*'} 'quoted wildcard'
+			assert {~ 'a*' a$star && !~ ab a$star} 'wildcard from a variable'
+			assert {~ ab a^* && ~ b [ab]} 'unquoted wildcard'
+			assert {~ - [a^'-'^c] && !~ b [a^'-'^c] && !~ b [a-c$close} 'range built by concatenation'
+			assert {~ <={~~ abc a*} bc && ~ <={~~ 'a*' a'*'} ()} 'extraction'
+		}
+	}
+}
@@ -0,0 +1,108 @@
+# tests/var.es -- verify lookups see every change to variables and functions
+
+test 'repeated lookups see redefinitions' {
+	let (seen = ()) {
+		for (i = 1 2 3) {
+			fn var-test-fn {result $i}
+			seen = $seen <={var-test-fn}
+		}
+		assert {~ $seen (1 2 3)} 'function redefined in a loop'
+		seen = ()
+		for (i = 1 2 3) {
+			var-test-var = $i
+			seen = $seen $var-test-var
+			var-test-var = ()
+			seen = $seen $#var-test-var
+		}
+		assert {~ $seen (1 0 2 0 3 0)} 'variable created and removed in a loop'
+	}
+	fn-var-test-fn = ()
+}
+
+test 'lookups respect local and let' {
+	var-test-var = global
+	let (seen = ()) {
+		for (i = 1 2) {
+			seen = $seen $var-test-var
+			local (var-test-var = local)
+				seen = $seen $var-test-var
+			let (var-test-var = lexical)
+				seen = $seen $var-test-var
+		}
+		assert {~ $seen (global local lexical global local lexical)} 'shadowing is seen each time'
+	}
+	var-test-var = ()
+	local (var-test-var = local)
+		assert {~ $var-test-var local} 'local creates an unset variable'
+	assert {~ $#var-test-var 0} 'and removes it again'
+}
+
+test 'settors and noexport are tracked' {
+	var-test-var = before
+	var-test-calls = ()
+	set-var-test-var = @ {var-test-calls = $var-test-calls $*; result $*}
+	var-test-var = one
+	local (var-test-var = two) true
+	set-var-test-var = ()
+	var-test-var = three
+	assert {~ $var-test-calls (one two one)} 'settor added to an existing variable'
+	assert {~ $var-test-var three} 'assignments still made'
+	let (seen = ()) {
+		local (noexport = $noexport var-test-var) seen = `{env | grep -c '^var__2dtest__2dvar='}
+		seen = $seen `{env | grep -c '^var__2dtest__2dvar='}
+		assert {~ <={%flatten ' ' $seen} '0 1'} 'noexport hides a variable and shows it again'
+	}
+	var-test-var = ()
+	var-test-calls = ()
+}
+
+test 'environment follows assignments' {
+	let (seen = ()) {
+		var-test-var = one
+		seen = `{env | grep '^var__2dtest__2dvar='}
+		var-test-var = two
+		seen = $seen `{env | grep '^var__2dtest__2dvar='}
+		local (var-test-var = three)
+			seen = $seen `{env | grep '^var__2dtest__2dvar='}
+		var-test-var = ()
+		seen = $seen `{env | grep -c '^var__2dtest__2dvar='}
+		assert {~ <={%flatten ' ' $seen} 'var__2dtest__2dvar=one var__2dtest__2dvar=two var__2dtest__2dvar=three 0'} 'exported values are current'
+	}
+	let (count = 0) {
+		fn var-test-fn {count = x}
+		var-test-fn
+		assert {~ `{env | grep '^fn__2dvar__2dtest__2dfn='} *count'='x*} 'closure bindings are current'
+	}
+	fn-var-test-fn = ()
+}
+
+test 'imported variables' {
+	local (var-test-var = 'a b' '' c; fn-var-test-fn = @ {result $#*}) {
+		assert {~ `` \n {$es -c 'echo $#var-test-var $var-test-var(1)'} '3 a b'} 'list is decoded'
+		assert {~ `` \n {$es -c 'echo <={var-test-fn x y}'} 2} 'function is decoded'
+		assert {~ `` \n {$es -c 'env | grep ''^var__2dtest__2dvar='''} `` \n {env | grep '^var__2dtest__2dvar='}} 'unused variable is passed on unchanged'
+		assert {~ `` \n {$es -c 'var-test-var = d; env | grep ''^var__2dtest__2dvar='''} 'var__2dtest__2dvar=d'} 'reassigned variable is exported again'
+	}
+}
+
+test 'function table' {
+	let (dir = `{mktemp -d}) {
+		local (function-table = $dir; fn-var-test-fn = @ {result $#*}) {
+			assert {~ `{env | grep -c '^fn__2dvar__2dtest__2dfn='} 0} 'function left out of the environment'
+			assert {~ `{env | grep '^ES_FNTABLE='} ES_FNTABLE'='$dir/es-fn-*} 'table is referenced'
+			assert {~ `` \n {$es -c 'echo <={var-test-fn x y}'} 2} 'child reads the table'
+			assert {~ `` \n {$es -c '$es -c ''echo <={var-test-fn x}'''} 1} 'grandchild too'
+			fn-var-test-fn = @ {result changed}
+			assert {~ `` \n {$es -c 'echo <={var-test-fn}'} changed} 'redefinition is shared'
+		}
+		assert {~ `{env | grep -c '^ES_FNTABLE='} 0} 'reference removed with the table'
+		assert {~ `{ls $dir | wc -l} 0} 'tables removed when no longer used'
+		assert {~ `` \n {$es -c 'function-table = '$dir'; for (i = 1 2 3 4 5) {fn var-test-fn {result $i}; /bin/true}; ls '$dir' | wc -l'} 1} 'replaced tables are removed'
+		assert {~ `{ls $dir | wc -l} 0} 'tables are removed at exit'
+		rm -rf $dir
+	}
+	let (exception = ()) {
+		catch @ e {exception = $e} {function-table = relative}
+		assert {~ $exception(1) error} 'relative directory is rejected'
+	}
+}
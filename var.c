@@ -1,11 +1,18 @@
 /* var.c -- es variables ($Revision: 1.1.1.1 $) */
 /* stdgetenv is based on the FreeBSD getenv */
 
+#define	REQUIRE_STAT	1
+#define	REQUIRE_FCNTL	1
+
 #include "es.h"
 #include "gc.h"
 #include "var.h"
 #include "term.h"
 
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
+
 #if PROTECT_ENV
 #define	ENV_FORMAT	"%F=%W"
 #define	ENV_DECODE	"%N"
@@ -16,8 +23,13 @@
 
 #define	ENVSIZE	40
 
+#define	FNTABLE_ENV	"ES_FNTABLE"
+#define	FNTABLE_MAGIC	"es function table 1\n"
+#define	MAGICLEN	(sizeof FNTABLE_MAGIC - 1)
+
 #define VECPUSH(vec, elt) STMT( \
 	(vec)->vector[(vec)->count++] = (elt); \
+	gcremember(vec); \
 	if ((vec)->count == (vec)->alloclen) { \
 		Vector *CONCAT(new_,vec) = mkvector((vec)->alloclen * 2); \
 		CONCAT(new_,vec)->count = (vec)->count; \
@@ -29,10 +41,17 @@
 
 Dict *vars = NULL;
 static Dict *noexport;
-static Vector *env, *sortenv;
+static Vector *env, *sortenv, *envchanges;
 static int envmin;
-static Boolean isdirty = TRUE;
-static Boolean rebound = TRUE;
+static Boolean isdirty = TRUE;		/* rebuild the whole environment */
+static char *fntabledir = NULL;		/* where to write function tables */
+static Vector *fnenv;			/* the functions in the table, sorted */
+static char *fntableref = NULL;		/* the table's entry in the environment */
+static Boolean fnchanged = FALSE;	/* fnenv differs from the table */
+static const char *fntableinherited = NULL;	/* the table loaded by initenv() */
+
+#define	sharedfn(name)	(fntabledir != NULL && hasprefix(name, "fn-"))
+static Boolean rebound = TRUE;		/* a lexical binding changed */
 
 DefineTag(Var, static);
 
@@ -52,14 +71,17 @@ static Boolean hasbindings(List *list) {
 }
 
 static Var *mkvar(List *defn) {
-	Ref(Var *, var, NULL);
-	Ref(List *, lp, defn);
-	var = gcnew(Var);
+	Var *var;
+	if (GCNEEDRESERVE(GCSIZE(Var))) {
+		RefAdd(defn);
+		gcreserve(GCSIZE(Var));
+		RefRemove(defn);
+	}
+	var = gcnewreserved(Var);
 	var->env = NULL;
-	var->defn = lp;
-	var->flags = hasbindings(lp) ? var_hasbindings : 0;
-	RefEnd(lp);
-	RefReturn(var);
+	var->defn = defn;
+	var->flags = hasbindings(defn) ? var_hasbindings : 0;
+	return var;
 }
 
 static void *VarCopy(void *op) {
@@ -71,7 +93,7 @@ static void *VarCopy(void *op) {
 static size_t VarScan(void *p) {
 	Var *var = p;
 	var->defn = forward(var->defn);
-	var->env = ((var->flags & var_hasbindings) && rebound) ? NULL : forward(var->env);
+	var->env = forward(var->env);
 	return sizeof (Var);
 }
 
@@ -113,21 +135,87 @@ static Boolean isexported(const char *name) {
 	return dictget(noexport, name) == NULL;
 }
 
+/* markexport -- bring a variable's var_noexport flag up to date */
+static void markexport(void UNUSED *dummy, char *name, void *value) {
+	Var *var = value;
+	if (isexported(name))
+		var->flags &= ~var_noexport;
+	else
+		var->flags |= var_noexport;
+}
+
 /* setnoexport -- mark a list of variable names not for export */
 extern void setnoexport(List *list) {
 	static char noexportchar = '!';
 
 	isdirty = TRUE;
-	if (list == NULL) {
+	if (list == NULL)
 		noexport = NULL;
-		return;
+	else {
+		gcdisable();
+		for (noexport = mkdict(); list != NULL; list = list->next)
+			noexport = dictput(noexport, getstr(list->term), &noexportchar);
+		gcenable();
 	}
-	gcdisable();
-	for (noexport = mkdict(); list != NULL; list = list->next)
-		noexport = dictput(noexport, getstr(list->term), &noexportchar);
-	gcenable();
+	dictforall(vars, markexport, NULL);
+}
+
+/*
+ * the lookup cache
+ *	a direct-mapped cache from names to global variables, which saves
+ *	hashing the names of commands and variables on every reference.
+ *	entries are keyed on the address of the name, so they are good
+ *	only while no variable is created or removed (vargeneration) and
+ *	nothing has moved or been freed (gcgeneration).
+ */
+
+#define	LOOKUPCACHE	256
+
+typedef struct {
+	const char *prefix, *name;
+	Var *var;
+	unsigned long vargen, gcgen;
+} Lookup;
+
+static Lookup lookupcache[LOOKUPCACHE];
+static unsigned long vargeneration = 1;
+
+#define	LOOKUPSLOT(prefix, name) \
+	(&lookupcache[(((size_t) (name) >> 3) ^ ((prefix) != NULL)) & (LOOKUPCACHE - 1)])
+
+static void varimport(Var *var);
+
+/* lookupglobal -- find the global variable prefix^name, or NULL */
+static Var *lookupglobal(const char *prefix, const char *name) {
+	Lookup *lp = LOOKUPSLOT(prefix, name);
+	if (
+		lp->name != name || lp->prefix != prefix
+		|| lp->vargen != vargeneration || lp->gcgen != gcgeneration
+	) {
+		Var *var = (prefix == NULL) ? dictget(vars, name) : dictget2(vars, prefix, name);
+		if (var != NULL && (var->flags & var_lazy)) {
+			RefAdd(name);
+			varimport(var);
+			var = (prefix == NULL) ? dictget(vars, name) : dictget2(vars, prefix, name);
+			RefRemove(name);
+			lp = LOOKUPSLOT(prefix, name);
+		}
+		lp->var = var;
+		lp->prefix = prefix;
+		lp->name = name;
+		lp->vargen = vargeneration;
+		lp->gcgen = gcgeneration;
+	}
+	return lp->var;
 }
 
+/*
+ * samename -- compare a variable name with a binding's name
+ *	sealed code shares one copy of each name, so a match is usually
+ *	found by comparing pointers and a mismatch by the first character.
+ */
+#define	samename(name, bname)	((name) == (bname) || (*(name) == *(bname) && streq(name, bname)))
+
 /* varlookup -- lookup a variable in the current context */
 extern List *varlookup(const char *name, Binding *bp) {
 	Var *var;
@@ -141,77 +229,172 @@ extern List *varlookup(const char *name, Binding *bp) {
 
 	validatevar(name);
 	for (; bp != NULL; bp = bp->next)
-		if (streq(name, bp->name))
+		if (samename(name, bp->name))
 			return bp->defn;
 
-	var = dictget(vars, name);
+	var = lookupglobal(NULL, name);
 	if (var == NULL)
 		return NULL;
 	return var->defn;
 }
 
+/* varlookup2 -- lookup the variable name1^name2, where name1 is a prefix like "fn-" */
 extern List *varlookup2(char *name1, char *name2, Binding *bp) {
 	Var *var;
-	
+
+	assert(*name1 != '\0');
 	for (; bp != NULL; bp = bp->next)
-		if (streq2(bp->name, name1, name2))
+		if (*bp->name == *name1 && streq2(bp->name, name1, name2))
 			return bp->defn;
 
-	var = dictget2(vars, name1, name2);
+	var = lookupglobal(name1, name2);
 	if (var == NULL)
 		return NULL;
 	return var->defn;
 }
 
-static List *callsettor(char *name, List *defn) {
+static List *callsettor(char *name0, List *defn) {
 	Push p;
 	List *settor;
 
-	if (specialvar(name) || (settor = varlookup2("set-", name, NULL)) == NULL)
+	if (specialvar(name0))
 		return defn;
 
+	/* looking up a lazily imported settor may collect */
+	Ref(char *, name, name0);
 	Ref(List *, lp, defn);
-	Ref(List *, fn, settor);
-	varpush(&p, "0", mklist(mkstr(name), NULL));
+	if ((settor = varlookup2("set-", name, NULL)) != NULL) {
+		Ref(List *, fn, settor);
+		varpush(&p, "0", mklist(mkstr(name), NULL));
+
+		lp = listcopy(eval(append(fn, lp), NULL, 0));
 
-	lp = listcopy(eval(append(fn, lp), NULL, 0));
+		varpop(&p);
+		RefEnd(fn);
+	}
+	defn = lp;
+	RefEnd2(lp, name);
+	return defn;
+}
 
-	varpop(&p);
-	RefEnd(fn);
-	RefReturn(lp);
+/* nameflags -- compute the flags which depend on a variable's name */
+static int nameflags(const char *name) {
+	int flags = 0;
+	if (!isexported(name))
+		flags |= var_noexport;
+	if (!specialvar(name) && dictget2(vars, "set-", name) != NULL)
+		flags |= var_hassettor;
+	return flags;
 }
 
+/* marksettor -- note that a settor variable was created or removed */
+static void marksettor(const char *name, Boolean present) {
+	Var *var;
+	if (!hasprefix(name, "set-") || specialvar(name + 4))
+		return;
+	var = dictget(vars, name + 4);
+	if (var != NULL) {
+		if (present)
+			var->flags |= var_hassettor;
+		else
+			var->flags &= ~var_hassettor;
+	}
+}
+
+/* exportable -- does a variable belong in the environment? */
+#define	exportable(var) \
+	(((var)->defn != NULL || ((var)->flags & var_lazy)) \
+	 && !((var)->flags & (var_noexport | var_isinternal)))
+
+/* markenv -- note that a variable's entry in the environment may have changed */
+static void markenv(char *name, Var *var) {
+	if ((var->flags & var_envdirty) || (var->env == NULL && !exportable(var)))
+		return;
+	var->flags |= var_envdirty;
+	if (envchanges->count + 2 > envchanges->alloclen) {
+		Vector *bigger;
+		Ref(char *, rname, name);
+		Ref(Var *, rvar, var);
+		bigger = mkvector(envchanges->alloclen * 2);
+		memcpy(bigger->vector, envchanges->vector, envchanges->count * sizeof (char *));
+		bigger->count = envchanges->count;
+		envchanges = bigger;
+		name = rname;
+		var = rvar;
+		RefEnd2(rvar, rname);
+	}
+	envchanges->vector[envchanges->count++] = name;
+	envchanges->vector[envchanges->count++] = (char *) var;
+	gcremember(envchanges);
+}
+
+/* addvar -- create a global variable */
+static void addvar(char *name, List *defn, int flags) {
+	Var *var;
+	Ref(char *, rname, name);
+	Ref(List *, rdefn, defn);
+	var = mkvar(NULL);
+	var->defn = rdefn;
+	var->flags = flags | nameflags(rname);
+	vars = dictput(vars, intern(rname), var);
+	++vargeneration;
+	marksettor(rname, TRUE);
+	markenv(rname, dictget(vars, rname));
+	RefEnd2(rdefn, rname);
+}
+
+/* rmvar -- remove a global variable */
+static void rmvar(char *name, Var *var) {
+	vars = dictput(vars, name, NULL);
+	++vargeneration;
+	marksettor(name, FALSE);
+	var->defn = NULL;
+	markenv(name, var);
+}
+
+/* setflags -- replace the flags which depend on a variable's value */
+#define	var_kept		(var_byname | var_envdirty)
+#define	setflags(var, f)	((var)->flags = ((var)->flags & var_kept) | ((f) & ~var_kept))
+
+/*
+ * vardef0 and varpush only look a name up once when it is already a
+ * global variable without a settor; the flags on the Var say whether
+ * it is exported, and a name found in vars must have been valid.
+ */
+
 static void vardef0(char *name, Binding *binding, List *defn, Boolean startup) {
 	Var *var;
 
-	validatevar(name);
+	/* looking up a lazily imported variable may collect */
+	RefAdd3(name, binding, defn);
+	var = lookupglobal(NULL, name);
+	if (var == NULL)
+		validatevar(name);
 	for (; binding != NULL; binding = binding->next)
-		if (streq(name, binding->name)) {
+		if (samename(name, binding->name)) {
 			binding->defn = defn;
+			gcremember(binding);
 			rebound = TRUE;
+			RefPop3(defn, binding, name);
 			return;
 		}
 
-	RefAdd(name);
-	if (!startup) {
+	if (!startup && (var == NULL || (var->flags & var_hassettor))) {
 		defn = callsettor(name, defn);
-		if (isexported(name))
-			isdirty = TRUE;
+		var = lookupglobal(NULL, name);
 	}
 
-	var = dictget(vars, name);
 	if (var != NULL)
 		if (defn != NULL) {
 			var->defn = defn;
-			var->env = NULL;
-			var->flags = hasbindings(defn) ? var_hasbindings : 0;
+			setflags(var, hasbindings(defn) ? var_hasbindings : 0);
+			gcremember(var);
+			markenv(name, var);
 		} else
-			vars = dictput(vars, name, NULL);
-	else if (defn != NULL) {
-		var = mkvar(defn);
-		vars = dictput(vars, name, var);
-	}
-	RefRemove(name);
+			rmvar(name, var);
+	else if (defn != NULL)
+		addvar(name, defn, hasbindings(defn) ? var_hasbindings : 0);
+	RefRemove3(defn, binding, name);
 }
 
 extern void vardef(char *name, Binding *binding, List *defn) {
@@ -221,36 +404,37 @@ extern void vardef(char *name, Binding *binding, List *defn) {
 extern void varpush(Push *push, char *name, List *defn) {
 	Var *var;
 
-	validatevar(name);
 	push->name = name;
-	push->nameroot.next = rootlist;
-	push->nameroot.p = (void **) &push->name;
-	rootlist = &push->nameroot;
+	ROOTPUSH(&push->name);
+	RefAdd(defn);
+	var = lookupglobal(NULL, push->name);
+	if (var == NULL)
+		validatevar(push->name);
 
-	if (isexported(name))
-		isdirty = TRUE;
-	defn = callsettor(name, defn);
+	if (var == NULL || (var->flags & var_hassettor)) {
+		defn = callsettor(push->name, defn);
+		var = lookupglobal(NULL, push->name);
+	}
+	RefRemove(defn);
 
-	var = dictget(vars, push->name);
 	if (var == NULL) {
 		push->defn	= NULL;
 		push->flags	= 0;
-		var		= mkvar(defn);
-		vars		= dictput(vars, push->name, var);
+		addvar(push->name, defn, hasbindings(defn) ? var_hasbindings : 0);
 	} else {
 		push->defn	= var->defn;
 		push->flags	= var->flags;
 		var->defn	= defn;
-		var->env	= NULL;
-		var->flags	= hasbindings(defn) ? var_hasbindings : 0;
+		setflags(var, hasbindings(defn) ? var_hasbindings : 0);
+		gcremember(var);
+		markenv(push->name, var);
 	}
 
 	push->next = pushlist;
 	pushlist = push;
 
-	push->defnroot.next = rootlist;
-	push->defnroot.p = (void **) &push->defn;
-	rootlist = &push->defnroot;
+	ROOTPUSH(&push->defn);
+	push->rootsp = rootsp;
 }
 
 extern void varpop(Push *push) {
@@ -258,68 +442,425 @@ extern void varpop(Push *push) {
 	List *volatile except = NULL;
 
 	assert(pushlist == push);
-	assert(rootlist == &push->defnroot);
-	assert(rootlist->next == &push->nameroot);
+	assert(rootsp == push->rootsp);
+	assert(rootstack[rootsp - 1] == (void **) &push->defn);
+	assert(rootstack[rootsp - 2] == (void **) &push->name);
 
-	if (isexported(push->name))
-		isdirty = TRUE;
+	var = lookupglobal(NULL, push->name);
+	if (var == NULL || (var->flags & var_hassettor)) {
 
-	ExceptionHandler
+		ExceptionHandler
 
-		push->defn = callsettor(push->name, push->defn);
+			push->defn = callsettor(push->name, push->defn);
 
-	CatchException (e)
+		CatchException (e)
 
-		except = e;
+			except = e;
 
-	EndExceptionHandler;
+		EndExceptionHandler;
 
-	var = dictget(vars, push->name);
+		var = lookupglobal(NULL, push->name);
+	}
 
 	if (var != NULL)
 		if (push->defn != NULL) {
 			var->defn = push->defn;
-			var->flags = push->flags;
-			var->env = NULL;
+			setflags(var, push->flags);
+			gcremember(var);
+			markenv(push->name, var);
 		} else
-			vars = dictput(vars, push->name, NULL);
-	else if (push->defn != NULL) {
-		var = mkvar(NULL);
-		var->defn = push->defn;
-		var->flags = push->flags;
-		vars = dictput(vars, push->name, var);
-	}
+			rmvar(push->name, var);
+	else if (push->defn != NULL)
+		addvar(push->name, push->defn, push->flags & ~var_kept);
 
 	pushlist = pushlist->next;
-	rootlist = rootlist->next->next;
+	rootsp -= 2;
 
 	if (except)
 		throw(except);
 }
 
+/*
+ * the environment
+ *	sortenv holds the exported variables, sorted, and each exported
+ *	Var keeps the string it has there in var->env.  assignments put
+ *	the variable on envchanges, and mkenv() replaces just those
+ *	strings; changing noexport rebuilds the whole thing.  a closure's
+ *	string depends on its bindings, so after any lexical variable is
+ *	assigned, the exported variables with bindings are redone too.
+ */
+
+/* clearenvchanges -- empty the list of changed variables */
+static void clearenvchanges(void) {
+	int i;
+	for (i = 1; i < envchanges->count; i += 2)
+		((Var *) envchanges->vector[i])->flags &= ~var_envdirty;
+	memzero(envchanges->vector, envchanges->count * sizeof (char *));
+	envchanges->count = 0;
+}
+
 static void mkenv0(void UNUSED *dummy, char *key, void *value) {
 	Var *var = value;
 	assert(gcisblocked());
-	if (
-		   var == NULL
-		|| var->defn == NULL
-		|| (var->flags & var_isinternal)
-		|| !isexported(key)
-	)
+	if (var == NULL || !exportable(var)) {
+		if (var != NULL && !(var->flags & var_lazy))
+			var->env = NULL;
 		return;
-	if (var->env == NULL || (rebound && (var->flags & var_hasbindings))) {
+	}
+	if (
+		var->env == NULL || (var->flags & var_envdirty)
+		|| (rebound && (var->flags & var_hasbindings))
+	) {
 		char *envstr = str(ENV_FORMAT, key, var->defn);
 		var->env = envstr;
+		gcremember(var);
+	}
+	if (sharedfn(key))
+		VECPUSH(fnenv, var->env);
+	else {
+		assert(env->count < env->alloclen);
+		VECPUSH(env, var->env);
+	}
+}
+
+/* markbound -- put variables whose closures have bindings on the list of changes */
+static void markbound(void UNUSED *dummy, char *key, void *value) {
+	Var *var = value;
+	if ((var->flags & var_hasbindings) && var->env != NULL)
+		markenv(key, var);
+}
+
+/* updateenv -- replace one variable's string in the environment */
+static void updateenv(char *name, Var *var) {
+	Vector **vp = &sortenv;
+	assert(gcisblocked());
+	assert(!(var->flags & var_lazy));
+	if (sharedfn(name)) {
+		vp = &fnenv;
+		fnchanged = TRUE;
+	}
+	var->flags &= ~var_envdirty;
+	if (var->env != NULL) {
+		sortedremove(*vp, var->env);
+		var->env = NULL;
+	}
+	if (exportable(var)) {
+		var->env = str(ENV_FORMAT, name, var->defn);
+		*vp = sortedinsert(*vp, var->env);
+	}
+	gcremember(var);
+}
+
+/*
+ * function tables
+ *	when function-table names a directory, the exported functions
+ *	are left out of the environment.  mkenv() writes them to a file
+ *	there, named for a hash of its contents, and exports a reference
+ *	to it in $ES_FNTABLE; initenv() reads it back.  the file holds
+ *	the same strings the environment would, each ending in a '\0'.
+ *
+ *	each shell writes its own tables, with its process id after the
+ *	hash, and reuses the one it was started with if it still fits.
+ *	a table it wrote is removed once another has replaced it, or the
+ *	shell exits, and no child it started is still running.
+ */
+
+typedef struct Written Written;
+struct Written {
+	char *path;
+	Written *next;
+};
+
+static Written *written = NULL;		/* tables this shell wrote */
+static pid_t writer = 0;		/* the process which wrote them */
+
+/* hashtable -- add bytes to the two 32-bit hashes which name a table */
+static void hashtable(unsigned int *h, const char *p, size_t n) {
+	const unsigned char *s = (const unsigned char *) p;
+	for (; n > 0; n--, s++) {
+		h[0] = (h[0] ^ *s) * 16777619;
+		h[1] = h[1] * 33 + *s;
+	}
+}
+
+#define	HASHINIT(h)	((h)[0] = 2166136261U, (h)[1] = 5381)
+#define	TABLENAME(h)	str("es-fn-%08lux%08lux", (unsigned long) (h)[0], (unsigned long) (h)[1])
+
+/* trustable -- could only we have written this table? */
+static Boolean trustable(struct stat *st) {
+	return S_ISREG(st->st_mode) && st->st_uid == geteuid() && (st->st_mode & 022) == 0;
+}
+
+/* writeall -- write a whole buffer, or fail */
+static Boolean writeall(int fd, const char *p, size_t n) {
+	while (n > 0) {
+		long i = write(fd, p, n);
+		if (i < 0) {
+			if (errno == EINTR)
+				continue;
+			return FALSE;
+		}
+		p += i;
+		n -= i;
+	}
+	return TRUE;
+}
+
+/* tablesuffix -- is this what may follow the hash in a table's name? */
+static Boolean tablesuffix(const char *s) {
+	if (*s == '\0')
+		return TRUE;
+	if (*s++ != '.' || *s == '\0')
+		return FALSE;
+	for (; *s != '\0'; s++)
+		if (!isdigit((unsigned char) *s))
+			return FALSE;
+	return TRUE;
+}
+
+/* sametable -- is path a table in fntabledir with the given hash? */
+static Boolean sametable(const char *path, const char *name) {
+	size_t n = strlen(fntabledir);
+	if (!strneq(path, fntabledir, n) || path[n] != '/')
+		return FALSE;
+	path += n + 1;
+	n = strlen(name);
+	return strneq(path, name, n) && tablesuffix(path + n);
+}
+
+/* ownwritten -- forget tables written by the process this one forked from */
+static void ownwritten(void) {
+	if (writer != getpid()) {
+		while (written != NULL) {
+			Written *w = written;
+			written = w->next;
+			efree(w->path);
+			efree(w);
+		}
+		writer = getpid();
+	}
+}
+
+/* prunefntables -- remove the tables this shell wrote that no child can need */
+static void prunefntables(Boolean all) {
+	Written *w, **wp;
+	const char *current;
+
+	ownwritten();
+	if (haschildren())
+		return;
+	current = fntableref == NULL ? NULL : fntableref + sizeof FNTABLE_ENV;
+	for (wp = &written; (w = *wp) != NULL;)
+		if (!all && current != NULL && streq(w->path, current))
+			wp = &w->next;
+		else {
+			unlink(w->path);
+			*wp = w->next;
+			efree(w->path);
+			efree(w);
+		}
+}
+
+/* removefntables -- at exit, remove the tables this shell wrote */
+static void removefntables(void) {
+	prunefntables(TRUE);
+}
+
+/* iswritten -- did this shell write the table? */
+static Boolean iswritten(const char *path) {
+	Written *w;
+	for (w = written; w != NULL; w = w->next)
+		if (streq(w->path, path))
+			return TRUE;
+	return FALSE;
+}
+
+/* addwritten -- remember a table this shell wrote */
+static void addwritten(const char *path) {
+	static Boolean registered = FALSE;
+	Written *w;
+	if (iswritten(path))
+		return;
+	w = ealloc(sizeof (Written));
+	w->path = ealloc(strlen(path) + 1);
+	strcpy(w->path, path);
+	w->next = written;
+	written = w;
+	if (!registered) {
+		atexit(removefntables);
+		registered = TRUE;
+	}
+}
+
+/* writefntable -- make sure a table holding fnenv exists, and set fntableref */
+static Boolean writefntable(void) {
+	int i, fd, err;
+	char *name, *path, *tmp;
+	unsigned int h[2];
+	struct stat st;
+	Boolean ok;
+
+	assert(gcisblocked());
+	ownwritten();
+	fnchanged = FALSE;
+	if (fnenv->count == 0) {
+		fntableref = NULL;
+		prunefntables(FALSE);
+		return TRUE;
+	}
+	HASHINIT(h);
+	for (i = 0; i < fnenv->count; i++)
+		hashtable(h, fnenv->vector[i], strlen(fnenv->vector[i]) + 1);
+	name = TABLENAME(h);
+	if (fntableref != NULL && sametable(fntableref + sizeof FNTABLE_ENV, name))
+		return TRUE;
+	if (fntableinherited != NULL && sametable(fntableinherited, name)
+	    && stat(fntableinherited, &st) == 0 && trustable(&st))
+		path = str("%s", fntableinherited);
+	else if (!iswritten(path = str("%s/%s.%d", fntabledir, name, getpid()))
+		 || stat(path, &st) == -1) {
+		/* anything else by this name was left by an earlier process */
+		tmp = str("%s.tmp", path);
+		unlink(tmp);
+		if ((fd = open(tmp, O_WRONLY | O_CREAT | O_EXCL, 0600)) == -1)
+			return FALSE;
+		ok = writeall(fd, FNTABLE_MAGIC, MAGICLEN);
+		for (i = 0; ok && i < fnenv->count; i++)
+			ok = writeall(fd, fnenv->vector[i], strlen(fnenv->vector[i]) + 1);
+		if (close(fd) == -1)
+			ok = FALSE;
+		unlink(path);
+		if (ok && link(tmp, path) == -1)
+			ok = FALSE;
+		err = errno;
+		unlink(tmp);
+		errno = err;
+		if (!ok)
+			return FALSE;
+		addwritten(path);
+	}
+	fntableref = str("%s=%s", FNTABLE_ENV, path);
+	prunefntables(FALSE);
+	return TRUE;
+}
+
+/* sharefailed -- give up on function tables */
+static void sharefailed(void) {
+	eprint("es: can't write function table in %s: %s; exporting functions in the environment\n",
+	       fntabledir, esstrerror(errno));
+	fntabledir = NULL;
+	isdirty = TRUE;
+}
+
+/* loadfntable -- read a table written by writefntable(); returns its strings */
+static char **loadfntable(const char *path) {
+	int fd, n;
+	size_t size;
+	char *p, *end, *map, **table;
+	const char *base, *problem = NULL;
+	unsigned int h[2];
+	struct stat st;
+
+	if ((fd = open(path, O_RDONLY)) == -1) {
+		eprint("es: function table %s: %s\n", path, esstrerror(errno));
+		return NULL;
 	}
-	assert(env->count < env->alloclen);
-	VECPUSH(env, var->env);
+	if (fstat(fd, &st) == -1 || !trustable(&st)) {
+		eprint("es: function table %s: not a private file\n", path);
+		close(fd);
+		return NULL;
+	}
+	size = st.st_size;
+#if HAVE_MMAP
+	map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map == MAP_FAILED)
+		map = NULL;
+#else
+	map = ealloc(size);
+	if ((size_t) read(fd, map, size) != size) {
+		efree(map);
+		map = NULL;
+	}
+#endif
+	close(fd);
+	if (map == NULL) {
+		eprint("es: function table %s: %s\n", path, esstrerror(errno));
+		return NULL;
+	}
+
+	p = map + MAGICLEN;
+	end = map + size;
+	HASHINIT(h);
+	base = strrchr(path, '/');
+	if (size <= MAGICLEN || memcmp(map, FNTABLE_MAGIC, MAGICLEN) != 0)
+		problem = "not a function table";
+	else if (end[-1] != '\0')
+		problem = "truncated";
+	else {
+		char *name;
+		hashtable(h, p, end - p);
+		name = TABLENAME(h);
+		base = (base == NULL) ? path : base + 1;
+		if (!strneq(base, name, strlen(name)) || !tablesuffix(base + strlen(name)))
+			problem = "contents do not match its name";
+	}
+	for (n = 0; problem == NULL && p < end; n++) {
+		if (strchr(p, '=') == NULL)
+			problem = "bad entry";
+		p += strlen(p) + 1;
+	}
+	if (problem != NULL) {
+		eprint("es: function table %s: %s\n", path, problem);
+#if HAVE_MMAP
+		munmap(map, size);
+#else
+		efree(map);
+#endif
+		return NULL;
+	}
+
+	table = ealloc((n + 1) * sizeof (char *));
+	for (n = 0, p = map + MAGICLEN; p < end; p += strlen(p) + 1)
+		table[n++] = p;
+	table[n] = NULL;
+	return table;
+}
+
+/* setfunctiontable -- set the directory for function tables, or turn them off */
+extern void setfunctiontable(char *dir) {
+	if (dir != NULL && *dir == '\0')
+		dir = NULL;
+	if (dir != NULL && *dir != '/')
+		fail("$&setfunctiontable", "function-table must be an absolute path: %s", dir);
+	fntableref = NULL;
+	prunefntables(FALSE);
+	fntabledir = dir;
+	isdirty = TRUE;
 }
-	
+
+/* sharefntable -- before a fork, write the table the child would otherwise write */
+extern void sharefntable(void) {
+	if (fntabledir != NULL && (isdirty || rebound || envchanges->count > 0))
+		mkenv();
+}
+
 extern Vector *mkenv(void) {
-	if (isdirty || rebound) {
+	if (isdirty || sortenv == NULL) {
 		env->count = envmin;
+		fnenv->count = 0;
 		gcdisable();		/* TODO: make this a good guess */
 		dictforall(vars, mkenv0, NULL);
+		clearenvchanges();
+		if (fntabledir != NULL) {
+			sortvector(fnenv);
+			if (!writefntable()) {
+				gcenable();
+				sharefailed();
+				return mkenv();
+			}
+			if (fntableref != NULL)
+				VECPUSH(env, fntableref);
+		}
 		gcenable();
 		env->vector[env->count] = NULL;
 		isdirty = FALSE;
@@ -328,7 +869,35 @@ extern Vector *mkenv(void) {
 			sortenv = mkvector(env->count * 2);
 		sortenv->count = env->count;
 		memcpy(sortenv->vector, env->vector, sizeof (char *) * (env->count + 1));
+		gcremember(sortenv);
 		sortvector(sortenv);
+	} else {
+		int i;
+		if (rebound) {
+			dictforall(vars, markbound, NULL);
+			rebound = FALSE;
+		}
+		if (envchanges->count > 0) {
+			gcdisable();
+			for (i = 0; i < envchanges->count; i += 2)
+				updateenv(envchanges->vector[i], (Var *) envchanges->vector[i + 1]);
+			clearenvchanges();
+			if (fnchanged) {
+				char *oldref = fntableref;
+				if (!writefntable()) {
+					gcenable();
+					sharefailed();
+					return mkenv();
+				}
+				if (oldref != fntableref) {
+					if (oldref != NULL)
+						sortedremove(sortenv, oldref);
+					if (fntableref != NULL)
+						sortenv = sortedinsert(sortenv, fntableref);
+				}
+			}
+			gcenable();
+		}
 	}
 	return sortenv;
 }
@@ -374,6 +943,51 @@ extern List *varswithprefix(char *prefix) {
 	RefReturn(varlist);
 }
 
+/*
+ * varcensus -- list each variable with the number of bytes reachable from it,
+ *	largest first.  structure shared between variables counts toward each.
+ */
+
+typedef struct {
+	char *name;
+	size_t bytes;
+} VarSize;
+
+static VarSize *varsizes = NULL;
+static int nvarsizes = 0, maxvarsizes = 0;
+
+static void sizevar(void UNUSED *arg, char *key, void *value) {
+	if (nvarsizes == maxvarsizes) {
+		maxvarsizes = (maxvarsizes == 0) ? 64 : maxvarsizes * 2;
+		varsizes = erealloc(varsizes, maxvarsizes * sizeof (VarSize));
+	}
+	varsizes[nvarsizes].name = key;
+	varsizes[nvarsizes].bytes = gcreachable(value);
+	++nvarsizes;
+}
+
+static int cmpvarsize(const void *p1, const void *p2) {
+	const VarSize *v1 = p1, *v2 = p2;
+	if (v1->bytes != v2->bytes)
+		return (v1->bytes < v2->bytes) ? 1 : -1;
+	return strcmp(v1->name, v2->name);
+}
+
+extern List *varcensus(void) {
+	int i;
+	Ref(List *, list, NULL);
+	gcdisable();
+	nvarsizes = 0;
+	dictforall(vars, sizevar, NULL);
+	qsort(varsizes, nvarsizes, sizeof (VarSize), cmpvarsize);
+	for (i = nvarsizes; i-- > 0;) {
+		list = mklist(mkstr(str("%uld", (unsigned long) varsizes[i].bytes)), list);
+		list = mklist(mkstr(varsizes[i].name), list);
+	}
+	gcenable();
+	RefReturn(list);
+}
+
 /* hide -- worker function for dictforall to hide initial state */
 static void hide(void UNUSED *dummy, char UNUSED *key, void *value) {
 	((Var *) value)->flags |= var_isinternal;
@@ -390,16 +1004,26 @@ extern void initvars(void) {
 	globalroot(&noexport);
 	globalroot(&env);
 	globalroot(&sortenv);
+	globalroot(&envchanges);
+	globalroot(&fntabledir);
+	globalroot(&fnenv);
+	globalroot(&fntableref);
 	vars = mkdict();
 	noexport = NULL;
 	env = mkvector(ENVSIZE);
+	envchanges = mkvector(ENVSIZE);
+	fnenv = mkvector(ENVSIZE);
 }
 
-/* importvar -- import a single environment variable */
-static void importvar(char *name0, char *value) {
+/* reservevars -- make room for a bulk load of count variables */
+extern void reservevars(int count) {
+	vars = dictreserve(vars, count);
+}
+
+/* importvalue -- decode the value of an environment variable */
+static List *importvalue(char *value) {
 	char sep[2] = { ENV_SEPARATOR, '\0' };
 
-	Ref(char *, name, name0);
 	Ref(List *, defn, NULL);
 	defn = fsplit(sep, mklist(mkstr(value), NULL), FALSE);
 
@@ -428,6 +1052,8 @@ static void importvar(char *name0, char *value) {
 						strcpy(str + offset, str2);
 						list->term->str = str;
 						list->next = list->next->next;
+						gcremember(list->term);
+						gcremember(list);
 					}
 					break;
 				    case ENV_ESCAPE: {
@@ -436,6 +1062,7 @@ static void importvar(char *name0, char *value) {
 					memcpy(str, word, offset);
 					strcpy(str + offset, escape + 2);
 					list->term->str = str;
+					gcremember(list->term);
 					offset += 1;
 					break;
 				    }
@@ -444,10 +1071,54 @@ static void importvar(char *name0, char *value) {
 		}
 		gcenable();
 	}
-	vardef0(name, NULL, defn, TRUE);
-	RefEnd2(defn, name);
+	RefReturn(defn);
 }
 
+/* importvar -- import a single environment variable */
+static void importvar(char *name0, char *value) {
+	Ref(char *, name, name0);
+	vardef0(name, NULL, importvalue(value), TRUE);
+	RefEnd(name);
+}
+
+/*
+ * lazy imports
+ *	most imported variables are never looked at, so initenv() only
+ *	records the environment string for a new name without a settor.
+ *	its value is decoded the first time the variable is looked up,
+ *	and until then mkenv() passes the string along untouched.
+ */
+
+/* addlazy -- create a variable from an environment string, without decoding it */
+static void addlazy(char *name, char *envstr) {
+	Var *var;
+	Ref(char *, rname, name);
+	var = mkvar(NULL);
+	var->env = envstr;
+	var->flags = var_lazy | nameflags(rname);
+	vars = dictput(vars, intern(rname), var);
+	++vargeneration;
+	marksettor(rname, TRUE);
+	RefEnd(rname);
+}
+
+/* varimport -- decode a lazily imported variable */
+static void varimport(Var *var) {
+	List *defn;
+	assert(var->flags & var_lazy);
+	Ref(Var *, rvar, var);
+	defn = importvalue(strchr(rvar->env, '=') + 1);
+	rvar->defn = defn;
+	rvar->flags &= ~var_lazy;
+	if (hasbindings(defn))
+		rvar->flags |= var_hasbindings;
+	if (!exportable(rvar))
+		rvar->env = NULL;
+	gcremember(rvar);
+	RefEnd(rvar);
+}
+
+
 #if LOCAL_GETENV
 static char *stdgetenv(const char *);
 static char *esgetenv(const char *);
@@ -549,14 +1220,13 @@ extern int putenv(char *envstr) {
 }
 #endif
 
-/* initenv -- load variables from the environment */
-extern void initenv(char **envp, Boolean protected) {
-	int i;
+/* importstrings -- load variables from environment strings, noting their names */
+static Vector *importstrings(char **envp, Boolean protected, Vector *imported0) {
 	char *envstr;
 	size_t bufsize = 1024;
 	char *buf = ealloc(bufsize);
 
-	Ref(Vector *, imported, mkvector(ENVSIZE));
+	Ref(Vector *, imported, imported0);
 	Ref(char *, name, NULL);
 	for (; (envstr = *envp) != NULL; envp++) {
 		size_t nlen;
@@ -565,6 +1235,8 @@ extern void initenv(char **envp, Boolean protected) {
 			VECPUSH(env, envstr);
 			continue;
 		}
+		if (hasprefix(envstr, FNTABLE_ENV "="))
+			continue;
 		for (nlen = eq - envstr; nlen >= bufsize; bufsize *= 2)
 			buf = erealloc(buf, bufsize);
 		memcpy(buf, envstr, nlen);
@@ -572,27 +1244,54 @@ extern void initenv(char **envp, Boolean protected) {
 		name = str(ENV_DECODE, buf);
 		if (!protected
 		    || (!hasprefix(name, "fn-") && !hasprefix(name, "set-"))) {
-			importvar(name, eq+1);
+			if (dictget(vars, name) == NULL && varlookup2("set-", name, NULL) == NULL)
+				addlazy(name, envstr);
+			else
+				importvar(name, eq+1);
 			VECPUSH(imported, name);
 		}
 	}
 	RefEnd(name);
+	efree(buf);
+	RefReturn(imported);
+}
+
+/* initenv -- load variables from the environment */
+extern void initenv(char **envp, Boolean protected) {
+	int i, n;
+	char **table = NULL;
+
+	for (n = 0; envp[n] != NULL; n++)
+		if (!protected && hasprefix(envp[n], FNTABLE_ENV "=")) {
+			table = loadfntable(envp[n] + sizeof FNTABLE_ENV);
+			if (table != NULL)
+				fntableinherited = envp[n] + sizeof FNTABLE_ENV;
+		}
+	if (table != NULL)
+		for (i = 0; table[i] != NULL; i++)
+			n++;
+	reservevars(n);
+
+	Ref(Vector *, imported, mkvector(ENVSIZE));
+	if (table != NULL)
+		imported = importstrings(table, protected, imported);
+	imported = importstrings(envp, protected, imported);
 
 	sortvector(imported);
 	Ref(Var *, var, NULL);
 	for (i = 0; i < imported->count; i++) {
-		char *name = imported->vector[i];
 		List *defn;
-		if (specialvar(name) || varlookup2("set-", name, NULL) == NULL)
+		if (specialvar(imported->vector[i])
+		    || varlookup2("set-", imported->vector[i], NULL) == NULL)
 			continue;
-		var = dictget(vars, name);
-		defn = callsettor(name, var->defn);
+		var = lookupglobal(NULL, imported->vector[i]);
+		defn = callsettor(imported->vector[i], var->defn);
 		var->defn = defn;
+		gcremember(var);
 	}
 
 	RefEnd2(var, imported);
 	envmin = env->count;
-	efree(buf);
 
 #if LOCAL_GETENV
 	realgetenv = esgetenv;
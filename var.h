@@ -9,5 +9,12 @@ struct Var {
 
 #define	var_hasbindings		1
 #define	var_isinternal		2
+#define	var_hassettor		4	/* there is a set-name variable */
+#define	var_noexport		8	/* special, or listed in noexport */
+#define	var_envdirty		16	/* on the list of changes for mkenv() */
+#define	var_lazy		32	/* imported but not decoded; env is the raw string */
+
+/* the flags which follow from a variable's name rather than its value */
+#define	var_byname		(var_hassettor | var_noexport)
 
 extern Dict *vars;
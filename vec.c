@@ -56,6 +56,7 @@ extern Boolean vectorappend(Vector *vector, const char *string)
     vector->vector[vector->count]     = string_copy;
     vector->vector[vector->count + 1] = NULL;  /* maintain sentinel */
     vector->count++;
+    gcremember(vector);
     
     return TRUE;
 }
@@ -122,6 +123,7 @@ extern Boolean vectorset(Vector *vector, int index, const char *string)
         
     string_copy              = gcdup(string);
     vector->vector[index]    = string_copy;
+    gcremember(vector);
     
     return TRUE;
 }
@@ -145,7 +147,9 @@ extern Vector *vectorcopy(Vector *source_vector)
     
     /* Copy all elements */
     for (element_index = 0; element_index < source_vector->count; element_index++)
-        new_vector->vector[element_index] = gcdup(source_vector->vector[element_index]);
+    {   new_vector->vector[element_index] = gcdup(source_vector->vector[element_index]);
+        gcremember(new_vector);
+    }
         
     /* Ensure NULL sentinel */
     new_vector->vector[new_vector->count] = NULL;
@@ -227,11 +231,15 @@ extern Vector *vectorconcat(Vector *first_vector, Vector *second_vector)
         
     /* Copy elements from first vector */
     for (element_index = 0; element_index < first_vector->count; element_index++)
-        result_vector->vector[result_index++] = gcdup(first_vector->vector[element_index]);
+    {   result_vector->vector[result_index++] = gcdup(first_vector->vector[element_index]);
+        gcremember(result_vector);
+    }
         
     /* Copy elements from second vector */
     for (element_index = 0; element_index < second_vector->count; element_index++)
-        result_vector->vector[result_index++] = gcdup(second_vector->vector[element_index]);
+    {   result_vector->vector[result_index++] = gcdup(second_vector->vector[element_index]);
+        gcremember(result_vector);
+    }
         
     result_vector->count                 = total_capacity;
     result_vector->vector[result_index] = NULL;  /* sentinel */
@@ -279,6 +287,7 @@ extern Vector *vectorize(List *list)
     for (element_index = 0; current_list != NULL; current_list = current_list->next, element_index++)
     {   char *string_value                   = getstr(current_list->term); /* must evaluate before assignment */
         result_vector->vector[element_index] = string_value;
+        gcremember(result_vector);
     }
 
     RefEnd(current_list);
@@ -302,3 +311,75 @@ extern void sortvector(Vector *vector)
 {   assert(vector->vector[vector->count] == NULL);
     qsort(vector->vector, vector->count, sizeof(char *), qstrcmp);
 }
+
+/* vectorsearch -- binary search a vector sorted by sortvector()
+ * Arguments:
+ *   vector: sorted vector to search
+ *   string: string to look for
+ *   found: set to whether the string is present
+ * Returns: index of the string, or where it would be inserted
+ */
+static int vectorsearch(Vector *vector, const char *string, Boolean *found)
+{   int low  = 0;
+    int high = vector->count;
+    
+    *found = FALSE;
+    while (low < high)
+    {   int middle     = (low + high) / 2;
+        int comparison = strcmp(vector->vector[middle], string);
+        
+        if (comparison == 0)
+        {   *found = TRUE;
+            return middle;
+        }
+        if (comparison < 0)
+            low = middle + 1;
+        else
+            high = middle;
+    }
+    return low;
+}
+
+/* sortedinsert -- add a string to a sorted vector, keeping it sorted
+ * Arguments:
+ *   vector: sorted vector to add to; collection must be disabled
+ *   string: string to add (not copied)
+ * Returns: the vector, or a larger copy of it
+ */
+extern Vector *sortedinsert(Vector *vector, char *string)
+{   Boolean found;
+    int     insert_index;
+    
+    assert(gcisblocked());
+    if (vector->count >= vector->alloclen)
+        vector = vectorresize(vector, vector->alloclen * 2 + 1);
+        
+    insert_index = vectorsearch(vector, string, &found);
+    memmove(&vector->vector[insert_index + 1], &vector->vector[insert_index],
+            (vector->count - insert_index) * sizeof (char *));
+    vector->vector[insert_index] = string;
+    vector->count++;
+    vector->vector[vector->count] = NULL;  /* maintain sentinel */
+    gcremember(vector);
+    
+    return vector;
+}
+
+/* sortedremove -- remove a string from a sorted vector
+ * Arguments:
+ *   vector: sorted vector to remove from
+ *   string: string to remove
+ * Returns: TRUE if the string was present
+ */
+extern Boolean sortedremove(Vector *vector, const char *string)
+{   Boolean found;
+    int     remove_index = vectorsearch(vector, string, &found);
+    
+    if (!found)
+        return FALSE;
+        
+    memmove(&vector->vector[remove_index], &vector->vector[remove_index + 1],
+            (vector->count - remove_index) * sizeof (char *));
+    vector->count--;
+    return TRUE;
+}